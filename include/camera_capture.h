@@ -0,0 +1,75 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include "frame_pool.h"
+#include "latest_frame_slot.h"
+#include "mjpeg_decoder.h"
+
+struct CapturedFrame {
+    cv::Mat image;                                    // Full-resolution BGR; empty in ROI decode mode
+    cv::Mat jpeg;                                     // Raw MJPEG bitstream in ROI decode mode
+    cv::Mat display;                                  // BGR at 1/display_scale of the frame size; may be
+                                                      // shared with the display, never written once published
+    int display_scale;
+    cv::Size size;                                    // Full frame size
+    uint64_t sequence;                                // 1 for the first frame, +1 per captured frame
+    std::chrono::steady_clock::time_point timestamp;  // When grab() returned, before decode
+
+    CapturedFrame() : display_scale(1), sequence(0) {}
+};
+
+// Grabs and decodes camera frames on a dedicated thread so MJPEG decode runs in
+// parallel with tracking. Only the newest frame is kept; the consumer never sees a
+// frame older than the one it already has.
+//
+// In ROI decode mode the camera's MJPEG bitstream is kept as is: the capture thread
+// only produces a DCT-scaled display image and full-resolution pixels are decoded on
+// demand, for the template and search regions, with decodeRegion().
+class CameraCapture {
+public:
+    CameraCapture();
+    ~CameraCapture();
+
+    // display_scale 2, 4 or 8 enables ROI decode mode; 1 decodes every frame in full
+    bool open(int device, int width, int height, int fps, int display_scale = 2);
+    void start();
+    void stop();
+
+    // Returns the newest frame captured since the previous call, waiting up to
+    // timeout_ms for one to arrive, or nullptr on timeout. The frame stays valid
+    // until the next call. Must only be called from one thread.
+    const CapturedFrame* waitForFrame(int timeout_ms);
+
+    // Full-resolution BGR pixels of roi (clipped to the frame). In full decode mode
+    // this is a view into the frame, otherwise bgr is decoded into a pooled buffer.
+    // Call from the waitForFrame() thread only.
+    bool decodeRegion(const CapturedFrame& frame, const cv::Rect& roi, cv::Mat& bgr);
+
+    // Frames that were overwritten before the consumer picked them up
+    uint64_t getSkippedCount() const;
+
+private:
+    void captureThreadFunc();
+
+    // Preallocated buffers for every per-frame image; declared before the frames that
+    // use them so they are destroyed last
+    std::unique_ptr<FramePool> bitstream_pool;
+    std::unique_ptr<FramePool> display_pool;
+    std::unique_ptr<FramePool> region_pool;
+
+    cv::VideoCapture cap;
+    LatestFrameSlot<CapturedFrame> slot;
+    std::thread capture_thread;
+    std::atomic<bool> stop_thread;
+    int display_scale;
+    MjpegDecoder display_decoder;  // Used by the capture thread
+
+    // Consumer-side bookkeeping
+    MjpegDecoder region_decoder;
+    uint64_t last_sequence;
+    uint64_t skipped_frames;
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include <CL/cl.h>
+#include <vector>
+
+// Grow-only pool of OpenCL buffers addressed by slot number. A slot keeps its
+// buffer across calls and is only reallocated when a larger size is requested,
+// so steady-state frames make no driver allocation calls.
+class DeviceBufferPool {
+public:
+    DeviceBufferPool();
+    ~DeviceBufferPool();
+    
+    void setContext(cl_context context);
+    
+    // Buffer for `slot` with at least `bytes` capacity. The pool keeps ownership;
+    // callers must not release the returned buffer.
+    cl_mem acquire(int slot, size_t bytes, cl_mem_flags flags = CL_MEM_READ_WRITE);
+    void releaseAll();
+    
+    size_t getAllocationCount() const;
+    size_t getCapacityBytes() const;
+    
+private:
+    struct Entry {
+        cl_mem buffer;
+        size_t capacity;
+        cl_mem_flags flags;
+    };
+    
+    cl_context context;
+    std::vector<Entry> entries;
+    size_t allocation_count;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+// Fixed-capacity pool of preallocated, cache-line aligned image buffers, used as a
+// cv::MatAllocator. A Mat created through the pool checks out one buffer; cv::Mat's own
+// reference count tracks every header that shares it (ROI views, copies handed to other
+// threads) and the buffer returns to the pool when the last one is released. Requests
+// larger than a slot, or made while every slot is checked out, fall back to the heap
+// and are counted.
+//
+// The pool must outlive every Mat allocated from it.
+class FramePool : public cv::MatAllocator {
+public:
+    FramePool(size_t slot_count, size_t slot_bytes);
+    ~FramePool();
+
+    // Makes the next allocation of `mat` (create, copyTo, cvtColor, ...) come from this
+    // pool. Has no effect on a buffer mat already holds.
+    void attach(cv::Mat& mat) const;
+
+    size_t getSlotBytes() const;
+    size_t getFreeCount() const;
+    size_t getFallbackCount() const;
+
+    // cv::MatAllocator
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override;
+    bool allocate(cv::UMatData* data, cv::AccessFlag access_flags,
+                  cv::UMatUsageFlags usage_flags) const override;
+    void deallocate(cv::UMatData* data) const override;
+
+private:
+    static const size_t kAlignment = 64;
+
+    size_t slot_bytes;
+    std::vector<unsigned char*> slots;
+
+    // Allocation state; allocate/deallocate are const in the MatAllocator interface
+    mutable std::mutex mutex;
+    mutable std::vector<unsigned char*> free_slots;
+    mutable size_t fallback_count;
+};
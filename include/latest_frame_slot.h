@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+
+// Single-producer/single-consumer "latest value wins" handoff built on three buffers.
+// The producer fills writeBuffer() and publishes it; the consumer picks up the most
+// recently published buffer and reads it through readBuffer(). Values that are
+// published before the consumer picks them up are overwritten, never queued.
+// Neither side ever blocks or takes a lock, and each buffer is owned by exactly one
+// side at a time, so T can be reused in place (e.g. a cv::Mat decoded into).
+template <typename T>
+class LatestFrameSlot {
+public:
+    LatestFrameSlot() : middle(1), back(0), front(2) {}
+
+    // Producer side: the buffer to fill next
+    T& writeBuffer() { return buffers[back]; }
+
+    // Producer side: hands the filled buffer to the consumer and takes back whichever
+    // buffer was waiting in the middle (stale or already consumed)
+    void publish() {
+        int previous = middle.exchange(back | kFreshBit, std::memory_order_acq_rel);
+        back = previous & kIndexMask;
+    }
+
+    // Consumer side: returns false when nothing was published since the last call
+    bool acquire() {
+        if (!(middle.load(std::memory_order_acquire) & kFreshBit)) {
+            return false;
+        }
+        int previous = middle.exchange(front, std::memory_order_acq_rel);
+        front = previous & kIndexMask;
+        return true;
+    }
+
+    // Consumer side: the buffer picked up by the last successful acquire(). It stays
+    // valid and unchanged until the next acquire().
+    T& readBuffer() { return buffers[front]; }
+
+private:
+    static const int kIndexMask = 3;
+    static const int kFreshBit = 4;
+
+    T buffers[3];
+    std::atomic<int> middle;  // Index of the handoff buffer plus kFreshBit when unread
+    int back;                 // Owned by the producer
+    int front;                // Owned by the consumer
+};
@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class LogLevel {
+    Debug = 0,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+// Asynchronous logger. Each thread formats its messages into its own lock-free ring
+// buffer and a background thread drains the rings to the output in timestamp order,
+// so callers never touch the terminal. Debug and Info go to stdout, Warning and Error
+// to stderr. A full ring drops messages instead of blocking.
+// Use the LOG_* macros: a disabled level costs one relaxed atomic load. The logger
+// lives until the process exits and flushes what is left at exit.
+class Logger {
+public:
+    static Logger& instance();
+    
+    static bool enabled(LogLevel level) {
+        return static_cast<int>(level) >= min_level.load(std::memory_order_relaxed);
+    }
+    static void setLevel(LogLevel level);
+    static LogLevel getLevel();
+    
+    // Accepts debug, info, warning, error and off
+    static bool parseLevel(const std::string& name, LogLevel& level);
+    
+    // True if at least interval_ms passed since the last time this returned true for `last_ns`
+    static bool rateLimit(std::atomic<int64_t>& last_ns, int64_t interval_ms);
+    
+    void write(LogLevel level, const char* format, ...) __attribute__((format(printf, 3, 4)));
+    
+    // Writes everything queued so far before returning
+    void flush();
+    
+    // Debug and Info are written to output, Warning and Error to error_output
+    void setOutput(FILE* output, FILE* error_output);
+    uint64_t getDroppedCount() const;
+    
+private:
+    static const size_t kRingCapacity = 256;
+    static const size_t kMessageSize = 232;
+    
+    struct Record {
+        int64_t timestamp_ns;
+        LogLevel level;
+        uint32_t thread_index;
+        char text[kMessageSize];
+    };
+    
+    // Single producer (its thread), single consumer (whoever holds drain_mutex)
+    struct Ring {
+        Record records[kRingCapacity];
+        std::atomic<size_t> head;
+        std::atomic<size_t> tail;
+        uint32_t thread_index;
+    };
+    
+    Logger();
+    Ring* threadRing();
+    void drainLoop();
+    void drain();
+    static void flushAtExit();
+    
+    static std::atomic<int> min_level;
+    
+    std::mutex rings_mutex;
+    std::vector<std::unique_ptr<Ring> > rings;
+    
+    std::mutex drain_mutex;
+    std::vector<Record> batch;
+    FILE* output;
+    FILE* error_output;
+    
+    std::atomic<uint64_t> dropped;
+    std::thread drain_thread;
+};
+
+#define LOG_AT(level, ...) \
+    do { \
+        if (Logger::enabled(level)) { \
+            Logger::instance().write(level, __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LogLevel::Warning, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel::Error, __VA_ARGS__)
+
+// At most one message per interval_ms from this call site; the rest are skipped
+#define LOG_EVERY_MS(level, interval_ms, ...) \
+    do { \
+        static std::atomic<int64_t> log_site_last_ns(INT64_MIN / 2); \
+        if (Logger::enabled(level) && Logger::rateLimit(log_site_last_ns, interval_ms)) { \
+            Logger::instance().write(level, __VA_ARGS__); \
+        } \
+    } while (0)
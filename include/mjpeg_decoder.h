@@ -0,0 +1,28 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+
+// libjpeg-turbo decoder for camera MJPEG frames. Besides full decodes it offers the two
+// partial decodes the live loop needs: a DCT-scaled decode for the display and a
+// full-resolution decode of a rectangle for tracking, which skips IDCT and colour
+// conversion for every MCU row and column outside the rectangle.
+class MjpegDecoder {
+public:
+    MjpegDecoder();
+    ~MjpegDecoder();
+
+    // Reads only the JPEG header
+    bool readSize(const uint8_t* data, size_t size, cv::Size& frame_size);
+
+    // Decodes the whole frame to BGR at 1/scale_denom resolution (1, 2, 4 or 8)
+    bool decodeScaled(const uint8_t* data, size_t size, int scale_denom, cv::Mat& bgr);
+
+    // Decodes roi (clipped to the frame) to BGR at full resolution
+    bool decodeRegion(const uint8_t* data, size_t size, const cv::Rect& roi, cv::Mat& bgr);
+
+private:
+    struct Context;
+    Context* context;
+    cv::Mat row_buffer;
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+
+// Constant-velocity Kalman filter on the tracked point, one independent [position,
+// velocity] filter per axis. predict() extrapolates to the next frame and grows the
+// uncertainty with the elapsed time; correct() folds in a match, trusting it less the
+// lower its confidence. The search window is centred on the prediction and sized from
+// the predicted position uncertainty, so it stays tight while motion is smooth and
+// widens after fast motion, low-confidence matches or lost frames.
+class MotionModel {
+public:
+    MotionModel();
+
+    // Restarts at a known position with zero velocity
+    void reset(const cv::Point2f& position);
+    bool isInitialized() const;
+
+    // Advances the state by dt seconds and returns the predicted position
+    cv::Point2f predict(double dt);
+
+    // Measurement for the current frame; confidence in (0, 1]
+    void correct(const cv::Point2f& measured, float confidence);
+
+    // Search window around the current prediction that contains the template at the
+    // predicted position plus n_sigma standard deviations, clipped to the frame.
+    // Sides are rounded up to multiples of kWindowAlignment so device buffers and
+    // kernel launches see a handful of distinct sizes rather than one per frame.
+    cv::Rect searchWindow(const cv::Size& template_size, const cv::Size& frame_size) const;
+
+    cv::Point2f getPosition() const;
+    cv::Point2f getVelocity() const;    // pixels per second
+
+    // Tuning; the defaults suit a hand-held 1080p camera at 30 fps
+    void setMaxMargin(int margin);      // Cap on the window half-size beyond the template
+
+private:
+    struct Axis {
+        double position;
+        double velocity;
+        double p00, p01, p11;           // Covariance of [position, velocity]
+
+        void predict(double dt, double acceleration_noise);
+        void correct(double measured, double measurement_variance);
+    };
+
+    static const int kWindowAlignment = 16;
+
+    Axis axes[2];
+    bool initialized;
+    int max_margin;
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "tracker_backend.h"
+#include "thread_pool.h"
+#include "stage_profiler.h"
+
+// CPU implementation of the tracker: the same zero-mean NCC as the OpenCL kernels,
+// with SIMD dot products (NEON, AVX2 or SSE2) and correlation rows split across
+// a thread pool pinned to the big cores.
+class NativeTracker : public TrackerBackend {
+private:
+    std::unique_ptr<ThreadPool> thread_pool;
+    ColorMode color_mode;
+    StageProfiler profiler;
+    
+    // Template in the tracking format plus the statistics the NCC needs
+    cv::Mat template_source;
+    cv::Mat template_image;
+    cv::Size template_size;
+    bool template_initialized;
+    int template_sum;
+    float template_norm;
+    
+    // Running float template behind updateTemplate(), and where the last match was found
+    // in search_staging
+    cv::Mat template_accumulator;
+    bool template_accumulator_valid;
+    cv::Point last_match;
+    bool last_match_valid;
+    
+    // Submitted ROIs by ticket; wait() runs them through track()
+    uint64_t next_ticket;
+    std::map<uint64_t, cv::Mat> pending_regions;
+    
+    // Per-frame scratch, reused across frames
+    cv::Mat search_staging;
+    cv::Mat integral_sum;
+    cv::Mat integral_sqsum;
+    std::vector<float> row_best_scores;
+    std::vector<int> row_best_x;
+    
+    int channelCount() const;
+    void convertForTracking(const cv::Mat& image, cv::Mat& converted) const;
+    void correlateRows(int row_begin, int row_end, int corr_width);
+    void computeTemplateStatistics();
+    
+public:
+    NativeTracker();
+    ~NativeTracker();
+    
+    bool initialize() override;
+    void setTemplate(const cv::Mat& template_roi) override;
+    bool track(const cv::Mat& search_region, cv::Point& location, float& confidence) override;
+    bool updateTemplate(float learning_rate) override;
+    
+    // Synchronous fallback: submit() keeps a copy of the ROI and wait() tracks it
+    uint64_t submit(const cv::Mat& search_region) override;
+    bool poll(uint64_t ticket) override;
+    bool wait(uint64_t ticket, cv::Point& location, float& confidence) override;
+    
+    void setColorMode(ColorMode mode) override;
+    ColorMode getColorMode() const override;
+    
+    const char* getName() const override;
+    
+    // Host stages only; statistics are dumped on destruction
+    void setProfiling(bool enabled) override;
+    void dumpProfile(std::ostream& out) override;
+    
+    // Threads used per frame, including the caller; 0 picks one per big core
+    void setThreadCount(int threads);
+    int getThreadCount() const;
+};
@@ -6,8 +6,24 @@
 class OpenCLUtils {
 public:
     static cl_context createContext();
-    static cl_command_queue createCommandQueue(cl_context context);
-    static cl_program createProgramFromFile(cl_context context, const std::string& filename);
+    static cl_command_queue createCommandQueue(cl_context context, cl_command_queue_properties properties = 0);
+    static cl_program createProgramFromFile(cl_context context, const std::string& filename,
+                                            const std::string& options = "");
     static std::string readKernelSource(const std::string& filename);
     static void checkError(cl_int error, const std::string& message);
+    
+    // Device binaries are cached here keyed by source, options, device and driver;
+    // an empty directory disables the cache
+    static void setProgramCacheDirectory(const std::string& directory);
+    static const std::string& getProgramCacheDirectory();
+    
+private:
+    static std::string programCacheKey(const std::string& source, const std::string& options,
+                                       cl_device_id device);
+    static cl_program loadCachedProgram(cl_context context, cl_device_id device,
+                                        const std::string& path, const std::string& options);
+    static void storeCachedProgram(cl_program program, const std::string& path);
+    static void buildProgram(cl_program program, cl_device_id device, const std::string& options);
+    
+    static std::string program_cache_directory;
 };
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <string>
+#include "tracker_backend.h"
+
+// Headless replay: tracks through a recorded video or an image directory without
+// camera, framebuffer or input devices, as fast as frames can be decoded
+struct ReplayOptions {
+    std::string input;          // video file, or directory of images processed in name order
+    cv::Rect roi;               // initial template in the first frame; empty = use roi_file
+    std::string roi_file;       // sidecar with "x y w h" (commas allowed); default <input>.roi
+    std::string output;         // per-frame CSV; default <input>.track.csv
+    int search_margin;          // fixed search half-size around the last match; 0 = sized
+                                // by the motion model around its prediction
+    float template_rate;        // updateTemplate() rate for confident matches; 0 = fixed template
+    
+    ReplayOptions() : search_margin(0), template_rate(0.05f) {}
+};
+
+// Parses "x,y,w,h" or "x y w h"; false if the text is not four integers
+bool parseRoi(const std::string& text, cv::Rect& roi);
+
+// Returns a process exit code
+int runReplay(TrackerBackend& tracker, const ReplayOptions& options);
@@ -0,0 +1,54 @@
+#pragma once
+#include <CL/cl.h>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Opt-in per-stage timing. Device commands are timed from their profiling events
+// (the queue needs CL_QUEUE_PROFILING_ENABLE), host work is recorded directly. Each
+// stage keeps a rolling window of recent samples from which percentiles are reported.
+class StageProfiler {
+public:
+    StageProfiler();
+    ~StageProfiler();
+    
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    
+    // Event slot for one enqueue of `stage`, or NULL when disabled; pass it straight
+    // to the clEnqueue* call
+    cl_event* newEvent(const char* stage);
+    
+    // Waits for the pending events and adds their timestamps to the stage statistics
+    void collect();
+    
+    void recordHost(const char* stage, double milliseconds);
+    void reset();
+    
+    // Table of count, p50/p95/p99 execution time and median queue/launch delay per
+    // stage, in milliseconds
+    void dump(std::ostream& out) const;
+    
+private:
+    struct PendingEvent {
+        std::string stage;
+        cl_event event;
+    };
+    
+    struct StageSamples {
+        std::vector<float> execute_ms;      // start -> end (host stages: wall time)
+        std::vector<float> queue_ms;        // queued -> submit, device stages only
+        std::vector<float> launch_ms;       // submit -> start, device stages only
+        size_t next;
+        uint64_t count;
+    };
+    
+    void addSample(const std::string& stage, float execute_ms, float queue_ms, float launch_ms);
+    
+    bool enabled;
+    std::deque<PendingEvent> pending;
+    std::map<std::string, StageSamples> stages;
+};
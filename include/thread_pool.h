@@ -0,0 +1,41 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. The calling thread takes part
+// in every loop, so a pool with N workers runs N + 1 chunks at a time.
+class ThreadPool {
+public:
+    // Workers are pinned round-robin to `cores` when it is not empty
+    explicit ThreadPool(int worker_count, const std::vector<int>& cores = std::vector<int>());
+    ~ThreadPool();
+    
+    int getThreadCount() const;
+    
+    // Splits [begin, end) into contiguous chunks, calls body(chunk_begin, chunk_end) for
+    // each of them in parallel and returns once all chunks are done. Only one thread
+    // may run loops on a pool at a time.
+    void parallelFor(int begin, int end, const std::function<void(int, int)>& body);
+    
+private:
+    void workerLoop();
+    void runChunks(std::unique_lock<std::mutex>& lock);
+    
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable work_cond;
+    std::condition_variable done_cond;
+    bool stopping;
+    
+    // Current loop, guarded by mutex
+    const std::function<void(int, int)>* body;
+    int range_begin;
+    int range_end;
+    int chunk_size;
+    int chunk_count;
+    int next_chunk;
+    int chunks_done;
+};
@@ -2,28 +2,350 @@
 #include <CL/cl.h>
 #include <opencv2/opencv.hpp>
 #include <vector>
+#include <map>
+#include <string>
+#include <tuple>
+#include <cstdint>
+#include "device_buffer_pool.h"
+#include "tracker_backend.h"
+#include "stage_profiler.h"
 
-class VisualTracker {
+// Correlation engine used by VisualTracker::track
+enum class NccMethod {
+    Direct,     // direct_ncc_tracker: recomputes every statistic per candidate
+    Integral,   // integral_ncc_tracker: cached template statistics + integral images
+    Tiled,      // tiled_ncc_tracker: Integral statistics + local-memory tiles, vector loads
+    Fft         // frequency-domain correlation with a cached template spectrum
+};
+
+// Outputs per work-item in tiled_ncc_tracker, must match TILED_OUTPUTS in the kernel
+const int kTiledOutputs = 4;
+
+// Local maximum of the correlation map, one per band of map rows
+struct CorrelationPeak {
+    cv::Point location;     // template centre in search region coordinates
+    float score;
+};
+
+// Outcome of an asynchronous tracking job, see VisualTracker::submit
+struct TrackResult {
+    cv::Point location;     // template centre in search region coordinates
+    float confidence;
+    bool success;
+};
+
+// Result of VisualTracker::trackAll for one target
+struct TargetResult {
+    int id;
+    cv::Point position;     // template centre in frame coordinates
+    float confidence;
+    bool success;
+};
+
+// Best match of the template bank, see VisualTracker::trackVariants
+struct VariantMatch {
+    cv::Point location;     // template centre in search region coordinates
+    float scale;            // relative to the template given to setTemplate
+    float angle;            // degrees, counter-clockwise
+    float confidence;
+    bool success;
+};
+
+class VisualTracker : public TrackerBackend {
 private:
     cl_context context;
+    cl_device_id device;
     cl_command_queue queue;
     cl_program program;
     cl_kernel ncc_kernel;
     
+    // Owns every device buffer; capacity persists across frames and templates
+    DeviceBufferPool buffer_pool;
+    
+    // Timing of the main queue's commands, see setProfiling
+    StageProfiler profiler;
+    bool queue_profiling;
+    
+    // Integral-image NCC kernels
+    cl_kernel integral_rows_kernel;
+    cl_kernel integral_cols_kernel;
+    cl_kernel integral_ncc_kernel;
+    NccMethod ncc_method;
+    
+    // Local-memory tiled NCC kernel and its work-group shape
+    cl_kernel tiled_ncc_kernel;
+    size_t tile_local_size[2];
+    cl_ulong local_mem_size;
+    
+    // Frequency-domain correlation kernels
+    cl_kernel fft_pack_bytes_kernel;
+    cl_kernel fft_pack_floats_kernel;
+    cl_kernel fft_radix2_kernel;
+    cl_kernel fft_multiply_kernel;
+    cl_kernel fft_normalize_kernel;
+    bool fft_auto_switch;
+    
+    // Measured FFT-versus-spatial winner per (search width, search height, channels)
+    typedef std::tuple<int, int, int> FftDecisionKey;
+    std::map<FftDecisionKey, bool> fft_decisions;
+    
+    // Template spectrum, cached for the padded size it was computed for
+    cl_mem template_spectrum_buf;
+    cv::Size spectrum_size;
+    
+    // Coarse-to-fine pyramid search. Level 0 is the template itself; the
+    // pyramid holds the downsampled levels 1..N
+    struct PyramidLevel {
+        cl_mem template_zm_buf;
+        cv::Size template_size;
+        float template_norm;
+    };
+    cl_kernel downsample_kernel;
+    cl_kernel window_search_kernel;
+    int pyramid_levels;
+    int refine_radius;
+    std::vector<PyramidLevel> template_pyramid;
+    cv::Mat template_image;
+    
+    // On-device argmax: two-stage reduction, only the result is read back
+    cl_kernel argmax_partial_kernel;
+    cl_kernel argmax_final_kernel;
+    size_t argmax_group_size;
+    
+    // Top-K peaks with non-maximum suppression, same two-stage layout as the argmax
+    cl_kernel topk_partial_kernel;
+    cl_kernel topk_final_kernel;
+    int top_k;
+    int peak_radius;                // 0: half the template's smaller side
+    std::vector<CorrelationPeak> peaks;
+    
+    // Asynchronous pipeline. Each job owns a rotating buffer set; uploads, compute
+    // and readbacks run on separate queues chained with events, so the upload of
+    // frame N+1, the compute of frame N and the readback of frame N-1 can overlap.
+    struct PipelineSet {
+        uint64_t ticket;            // 0 when the set is free
+        cv::Mat staging;            // host copy of the ROI, alive until uploaded
+        cl_mem search_buf;
+        cl_mem result_buf;
+        cl_int result[2];
+        cl_event upload_event;
+        cl_event compute_event;
+        cl_event readback_event;
+        int corr_width;
+        int search_row_length;
+        cv::Size template_size;
+    };
+    cl_command_queue upload_queue;
+    cl_command_queue readback_queue;
+    std::vector<PipelineSet> pipeline_sets;
+    int next_set;
+    uint64_t next_ticket;
+    std::map<uint64_t, TrackResult> completed_results;
+    std::map<uint64_t, cv::Mat> deferred_regions;     // jobs wait() runs through track()
+    
+    // Multi-target tracking: templates and search ROIs of all targets are packed
+    // into shared buffers and scored with one batched launch
+    struct Target {
+        int id;
+        std::vector<float> template_zm;
+        cv::Size template_size;
+        float template_norm;
+        int template_offset;    // into the packed template buffer, in floats
+        cv::Point position;     // last known template centre in frame coordinates
+    };
+    cl_kernel batched_ncc_kernel;
+    cl_kernel batched_argmax_kernel;
+    std::vector<Target> targets;
+    int next_target_id;
+    bool targets_dirty;
+    std::vector<uchar> batch_search_staging;
+    std::vector<cl_int> batch_descriptors;
+    std::vector<cl_int> batch_results;
+    
+    // Scaled and rotated copies of the template, packed like the multi-target templates
+    // and scored by the same batched kernels against one shared search region
+    struct TemplateVariant {
+        float scale;
+        float angle;
+        cv::Size template_size;
+        float template_norm;
+        int template_offset;    // into the packed bank buffer, in floats
+    };
+    std::vector<float> bank_scales;
+    std::vector<float> bank_angles;
+    std::vector<TemplateVariant> template_bank;
+    std::vector<cl_int> bank_descriptors;
+    std::vector<cl_int> bank_results;
+    
+    // Correlation kernels compiled for one template shape (-D TEMPLATE_W/TEMPLATE_H/CHANNELS),
+    // keyed by their build options; a variant whose build failed keeps a null program
+    struct KernelVariant {
+        cl_program program;
+        cl_kernel direct;
+        cl_kernel integral;
+        cl_kernel tiled;
+        cl_kernel grayscale;
+    };
+    std::map<std::string, KernelVariant> kernel_variants;
+    const KernelVariant* active_variant;
+    bool specialised_kernels;
+    
+    // Single-channel mode and its specialised kernel
+    ColorMode color_mode;
+    cl_kernel grayscale_ncc_kernel;
+    cv::Mat template_source;
+    cv::Mat search_staging;
+    
     // Template image (stored as OpenCL buffer)
     cl_mem template_buf;
     cv::Size template_size;
     bool template_initialized;
     
+    // Zero-mean template and its norm, computed once per template
+    cl_mem template_zm_buf;
+    float template_norm;
+    int template_sum;
+    
+    // On-device template adaptation, see updateTemplate. The patch is read straight
+    // from the search buffer of the last track(), which stays valid until the next one.
+    cl_kernel template_update_kernel;
+    size_t template_update_group_size;
+    cl_mem last_search_buf;
+    int last_search_row_length;
+    cv::Point last_match;               // top-left of the matched patch
+    bool last_match_valid;
+    bool template_accumulator_valid;
+    bool template_image_stale;          // host copy predates device-side updates
+    cl_event template_stats_event;      // pending readback of the updated statistics
+    std::vector<cl_ulong> template_stats;
+    
 public:
     VisualTracker();
     ~VisualTracker();
     
-    bool initialize();
-    void setTemplate(const cv::Mat& template_roi);
-    bool track(const cv::Mat& search_region, cv::Point& location, float& confidence);
+    bool initialize() override;
+    void setTemplate(const cv::Mat& template_roi) override;
+    bool track(const cv::Mat& search_region, cv::Point& location, float& confidence) override;
     void cleanup();
     
+    const char* getName() const override;
+    
+    // Times every command enqueued by track() and setTemplate(). Enabling it recreates
+    // the main queue with CL_QUEUE_PROFILING_ENABLE; statistics are dumped at cleanup.
+    void setProfiling(bool enabled) override;
+    void dumpProfile(std::ostream& out) override;
+    
+    // Asynchronous tracking: submit() enqueues the job and returns a ticket (0 on
+    // error) without waiting for the device. poll() reports whether the result is
+    // ready; wait() blocks for it and returns the same values as track(). Pyramid
+    // searches keep a copy of the ROI and run synchronously inside wait().
+    uint64_t submit(const cv::Mat& search_region) override;
+    bool poll(uint64_t ticket) override;
+    bool wait(uint64_t ticket, cv::Point& location, float& confidence) override;
+    
+    // Multi-target tracking. Each target keeps its own template and last position;
+    // trackAll() searches +/- search_margin around every target of a BGR frame
+    // with a single batched kernel launch and per-target argmax.
+    int addTarget(const cv::Mat& template_roi, const cv::Point& position);
+    bool removeTarget(int id);
+    size_t getTargetCount() const;
+    std::vector<TargetResult> trackAll(const cv::Mat& frame, int search_margin = 100);
+    
+    // Template bank for targets that grow, shrink or rotate. setTemplate() then also
+    // renders one variant per (scale, angle) pair, angles in degrees counter-clockwise,
+    // each cropped to the largest rectangle that stays inside the rotated template.
+    // trackVariants() scores every variant against the search region in one launch, the
+    // variant index being the third NDRange dimension, and returns the best position
+    // with its scale and angle. Empty lists disable the bank. The variants are built
+    // from the template as set; updateTemplate() does not change them.
+    void setTemplateBank(const std::vector<float>& scales, const std::vector<float>& angles);
+    size_t getTemplateBankSize() const;
+    VariantMatch trackVariants(const cv::Mat& search_region);
+    
+    // Build and use kernels specialised for the template size when it is a common one
+    void setSpecialisedKernels(bool enabled);
+    
+    // Blends the patch matched by the last track() into the template on the device,
+    // T = (1 - learning_rate) * T + learning_rate * patch, and refreshes the zero-mean
+    // template, its statistics and the pyramid levels in place: one small kernel launch
+    // plus one per pyramid level, no allocation, no upload. The blend accumulates in
+    // floats, so small rates do not round away. Returns false when there is no match.
+    bool updateTemplate(float learning_rate) override;
+    
+    // Switching the color mode re-applies the current template in the new format;
+    // adaptation by updateTemplate() starts over from the original template
+    void setColorMode(ColorMode mode) override;
+    ColorMode getColorMode() const override;
+    
+    void setNccMethod(NccMethod method);
+    NccMethod getNccMethod() const;
+    
+    // Work-group shape of the tiled kernel; each work-group covers
+    // (local_width * kTiledOutputs) x local_height correlation outputs
+    void setTileShape(int local_width, int local_height);
+    
+    // Switch to the FFT path automatically when it is faster. Both paths are timed
+    // on the device the first time each search size is seen with the current template.
+    void setFftAutoSwitch(bool enabled);
+    
+    // Coarse-to-fine search: full search at the coarsest of `levels` pyramid levels,
+    // then refinement within +/- refine_radius at each finer level. levels == 1
+    // disables the pyramid.
+    void setPyramid(int levels, int refine_radius = 2);
+    
+    // Number of peaks reported by getPeaks() after each track() (1 = best match only).
+    // Peaks are local maxima of the score map, best first, no two within
+    // suppression_radius pixels of each other; 0 uses half the template's smaller side.
+    void setTopK(int k, int suppression_radius = 0);
+    const std::vector<CorrelationPeak>& getPeaks() const;
+    
+    // Number of device buffer allocations made so far; stays constant in steady state
+    size_t getDeviceAllocationCount() const;
+    
 private:
     cv::Mat preprocessImage(const cv::Mat& image);
-};
\ No newline at end of file
+    int channelCount() const;
+    void selectKernelVariant();
+    const KernelVariant* buildKernelVariant(const std::string& options);
+    void convertForTracking(const cv::Mat& image, cv::Mat& converted) const;
+    void enqueueGrayscaleNcc(cl_mem search_buf, cl_mem correlation_buf,
+                             int search_width, int search_height);
+    void computeTemplateStatistics(const cv::Mat& processed, std::vector<float>& template_zm,
+                                   float& norm, int& sum);
+    void enqueueDirectNcc(cl_mem search_buf, cl_mem correlation_buf,
+                          int search_width, int search_height, int channels);
+    void enqueueIntegralNcc(cl_mem search_buf, cl_mem correlation_buf,
+                            int search_width, int search_height, int channels);
+    void enqueueTiledNcc(cl_mem search_buf, cl_mem correlation_buf,
+                         int search_width, int search_height, int channels);
+    void enqueueFftNcc(cl_mem search_buf, cl_mem correlation_buf,
+                       int search_width, int search_height, int channels);
+    void enqueueFft2d(cl_mem& data, cl_mem& scratch, int width, int height, float direction);
+    void updateTemplateSpectrum(cv::Size padded_size, int channels);
+    bool fftAvailable() const;
+    bool largeTemplatesAllowed() const;     // FFT method selected, so the 256 px cap applies
+    bool fftIsFaster(cl_mem search_buf, cl_mem correlation_buf,
+                     int search_width, int search_height, int channels);
+    void enqueueCorrelation(cl_mem search_buf, cl_mem correlation_buf,
+                            int search_width, int search_height, int channels);
+    void enqueueSpatialNcc(cl_mem search_buf, cl_mem correlation_buf,
+                           int search_width, int search_height, int channels);
+    int enqueueArgmax(cl_mem scores_buf, int count, cl_mem result_buf);
+    TrackResult collectPipelineSet(PipelineSet& set);
+    void storeCompletedResult(uint64_t ticket, const TrackResult& result);
+    void uploadTargetTemplates();
+    float findBestMatch(cl_mem scores_buf, int count, int& best_index);
+    int findPeaks(cl_mem scores_buf, int map_width, int map_height,
+                  std::vector<std::pair<float, int> >& top_candidates);
+    void syncTemplateStatistics();
+    void buildTemplatePyramid();
+    void buildTemplateBank();
+    void releaseTemplatePyramid();
+    void searchPyramid(cl_mem search_buf, int search_width, int search_height, int channels,
+                       int& best_x, int& best_y, float& best_correlation);
+    float searchWindow(cl_mem level_template_zm, cv::Size level_template_size, float level_template_norm,
+                       cl_mem level_search, int level_search_width, int channels,
+                       const cv::Rect& window, cv::Point& best);
+    void enqueueIntegralImages(cl_mem search_buf, cl_mem integral_sum_buf, cl_mem integral_sqsum_buf,
+                               int search_width, int search_height, int channels);
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+// Pixel format the tracker correlates on
+enum class ColorMode {
+    Bgr,        // 3-channel BGR as delivered by the camera
+    Gray        // 8-bit luma, a third of the upload bytes and arithmetic
+};
+
+// Which implementation createTrackerBackend should build
+enum class BackendType {
+    Auto,       // OpenCL when a device is available, otherwise Native
+    OpenCL,     // VisualTracker on the GPU (or an OpenCL CPU device)
+    Native      // NativeTracker: SIMD NCC on a pool of CPU threads
+};
+
+// Single-target template tracker. Locations are template centres in search region
+// coordinates; track() returns false when the best match is below the confidence threshold.
+class TrackerBackend {
+public:
+    virtual ~TrackerBackend() {}
+    
+    virtual bool initialize() = 0;
+    virtual void setTemplate(const cv::Mat& template_roi) = 0;
+    virtual bool track(const cv::Mat& search_region, cv::Point& location, float& confidence) = 0;
+    
+    // Blends the patch matched by the last track() into the template with the given
+    // learning rate so it follows appearance changes; false when there is nothing to blend
+    virtual bool updateTemplate(float) { return false; }
+    
+    // Asynchronous tracking: submit() starts a job and returns a ticket (0 on error),
+    // poll() reports whether its result is ready and wait() returns the same values as
+    // track(). updateTemplate() after wait() blends the match of the waited-for job.
+    virtual uint64_t submit(const cv::Mat& search_region) = 0;
+    virtual bool poll(uint64_t ticket) = 0;
+    virtual bool wait(uint64_t ticket, cv::Point& location, float& confidence) = 0;
+    
+    virtual void setColorMode(ColorMode mode) = 0;
+    virtual ColorMode getColorMode() const = 0;
+    
+    virtual const char* getName() const = 0;
+    
+    // Opt-in per-stage timing; dumpProfile writes p50/p95/p99 per stage
+    virtual void setProfiling(bool) {}
+    virtual void dumpProfile(std::ostream&) {}
+};
+
+// Builds and initializes a backend; returns nullptr when none could be initialized
+std::unique_ptr<TrackerBackend> createTrackerBackend(BackendType type = BackendType::Auto);
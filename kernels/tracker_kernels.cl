@@ -1,14 +1,38 @@
+// Specialised builds: the host compiles this file again with -D TEMPLATE_W, -D TEMPLATE_H
+// and -D CHANNELS for common template shapes. The NCC kernels below then see those sizes as
+// compile-time constants (so their loops can be unrolled) and ignore the runtime arguments.
+#ifdef TEMPLATE_W
+#define SPECIALISED_WIDTH(runtime) (TEMPLATE_W)
+#else
+#define SPECIALISED_WIDTH(runtime) (runtime)
+#endif
+
+#ifdef TEMPLATE_H
+#define SPECIALISED_HEIGHT(runtime) (TEMPLATE_H)
+#else
+#define SPECIALISED_HEIGHT(runtime) (runtime)
+#endif
+
+#ifdef CHANNELS
+#define SPECIALISED_CHANNELS(runtime) (CHANNELS)
+#else
+#define SPECIALISED_CHANNELS(runtime) (runtime)
+#endif
+
 // Simple normalized cross-correlation tracker
 __kernel void direct_ncc_tracker(
     __global const uchar* template_img,
     __global const uchar* search_region,
     __global float* correlation_map,
-    const int template_width,
-    const int template_height,
+    const int template_width_arg,
+    const int template_height_arg,
     const int search_width,
     const int search_height,
-    const int channels
+    const int channels_arg
 ) {
+    const int template_width = SPECIALISED_WIDTH(template_width_arg);
+    const int template_height = SPECIALISED_HEIGHT(template_height_arg);
+    const int channels = SPECIALISED_CHANNELS(channels_arg);
     int x = get_global_id(0);
     int y = get_global_id(1);
     
@@ -64,4 +88,1067 @@ __kernel void direct_ncc_tracker(
     }
     
     correlation_map[y * (search_width - template_width) + x] = correlation;
-}
\ No newline at end of file
+}
+
+// Integral images of the per-pixel channel sum and sum of squares.
+// Both images are (width + 1) x (height + 1) with a zero first row and column,
+// so the sum over any window is four lookups. Integer accumulators keep the
+// window statistics exact regardless of the window size.
+//
+// Pass 1: one work-item per integral row computes the horizontal prefix sums.
+__kernel void integral_rows(
+    __global const uchar* image,
+    __global uint* integral_sum,
+    __global ulong* integral_sqsum,
+    const int width,
+    const int height,
+    const int channels
+) {
+    int y = get_global_id(0);
+    if (y > height) {
+        return;
+    }
+    
+    int stride = width + 1;
+    __global uint* sum_row = integral_sum + y * stride;
+    __global ulong* sqsum_row = integral_sqsum + y * stride;
+    
+    sum_row[0] = 0;
+    sqsum_row[0] = 0;
+    
+    if (y == 0) {
+        for (int x = 1; x <= width; x++) {
+            sum_row[x] = 0;
+            sqsum_row[x] = 0;
+        }
+        return;
+    }
+    
+    __global const uchar* image_row = image + (y - 1) * width * channels;
+    uint sum = 0;
+    ulong sqsum = 0;
+    
+    for (int x = 0; x < width; x++) {
+        uint pixel_sum = 0;
+        uint pixel_sqsum = 0;
+        for (int ch = 0; ch < channels; ch++) {
+            uint value = image_row[x * channels + ch];
+            pixel_sum += value;
+            pixel_sqsum += value * value;
+        }
+        sum += pixel_sum;
+        sqsum += pixel_sqsum;
+        sum_row[x + 1] = sum;
+        sqsum_row[x + 1] = sqsum;
+    }
+}
+
+// Pass 2: one work-item per integral column accumulates the row sums vertically.
+__kernel void integral_cols(
+    __global uint* integral_sum,
+    __global ulong* integral_sqsum,
+    const int width,
+    const int height
+) {
+    int x = get_global_id(0);
+    if (x > width) {
+        return;
+    }
+    
+    int stride = width + 1;
+    uint sum = 0;
+    ulong sqsum = 0;
+    
+    for (int y = 1; y <= height; y++) {
+        sum += integral_sum[y * stride + x];
+        sqsum += integral_sqsum[y * stride + x];
+        integral_sum[y * stride + x] = sum;
+        integral_sqsum[y * stride + x] = sqsum;
+    }
+}
+
+// Normalized cross-correlation using statistics that do not change per candidate:
+// the template is uploaded zero-mean together with its norm, and the window sum and
+// sum of squares come from the integral images. Since the template is zero-mean,
+// sum(t' * s) == sum(t' * (s - mean_s)), so one dot product per candidate remains.
+__kernel void integral_ncc_tracker(
+    __global const float* template_zm,
+    __global const uchar* search_region,
+    __global const uint* integral_sum,
+    __global const ulong* integral_sqsum,
+    __global float* correlation_map,
+    const int template_width_arg,
+    const int template_height_arg,
+    const int search_width,
+    const int search_height,
+    const int channels_arg,
+    const float template_norm
+) {
+    const int template_width = SPECIALISED_WIDTH(template_width_arg);
+    const int template_height = SPECIALISED_HEIGHT(template_height_arg);
+    const int channels = SPECIALISED_CHANNELS(channels_arg);
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    
+    if (x >= search_width - template_width || y >= search_height - template_height) {
+        return;
+    }
+    
+    // Template rows and search rows are contiguous over all channels
+    int row_length = template_width * channels;
+    float numerator = 0.0f;
+    
+    for (int ty = 0; ty < template_height; ty++) {
+        __global const float* template_row = template_zm + ty * row_length;
+        __global const uchar* search_row = search_region + ((y + ty) * search_width + x) * channels;
+        
+        for (int i = 0; i < row_length; i++) {
+            numerator += template_row[i] * convert_float(search_row[i]);
+        }
+    }
+    
+    // Window statistics in O(1)
+    int stride = search_width + 1;
+    int x1 = x + template_width;
+    int y1 = y + template_height;
+    
+    uint window_sum = integral_sum[y1 * stride + x1] - integral_sum[y * stride + x1]
+                    - integral_sum[y1 * stride + x] + integral_sum[y * stride + x];
+    ulong window_sqsum = integral_sqsum[y1 * stride + x1] - integral_sqsum[y * stride + x1]
+                       - integral_sqsum[y1 * stride + x] + integral_sqsum[y * stride + x];
+    
+    // n * sum((s - mean)^2) = n * sum(s^2) - sum(s)^2, exact in 64-bit integers
+    long total_pixels = (long)template_width * template_height * channels;
+    long scaled_var = total_pixels * (long)window_sqsum - (long)window_sum * (long)window_sum;
+    float search_var = convert_float(scaled_var) / convert_float(total_pixels);
+    
+    float correlation = 0.0f;
+    if (template_norm > 1e-3f && search_var > 1e-6f) {
+        correlation = numerator / (template_norm * sqrt(search_var));
+        correlation = (correlation + 1.0f) * 0.5f;
+    }
+    
+    correlation_map[y * (search_width - template_width) + x] = correlation;
+}
+
+// Number of horizontally adjacent correlation outputs computed by each work-item
+// of tiled_ncc_tracker. The host sizes its NDRange with the same value.
+#ifndef TILED_OUTPUTS
+#define TILED_OUTPUTS 4
+#endif
+
+inline uint sum_uint16(uint16 v) {
+    uint8 a = v.lo + v.hi;
+    uint4 b = a.lo + a.hi;
+    uint2 c = b.lo + b.hi;
+    return c.x + c.y;
+}
+
+// Copy `count` bytes from global to local memory with all work-items of the group,
+// four bytes per work-item and iteration.
+inline void load_bytes_to_local(
+    __global const uchar* src,
+    __local uchar* dst,
+    int count,
+    int src_limit,
+    int flat_id,
+    int group_size
+) {
+    for (int i = flat_id * 4; i < count; i += group_size * 4) {
+        if (i + 4 <= count && i + 4 <= src_limit) {
+            vstore4(vload4(0, src + i), 0, dst + i);
+        } else {
+            for (int k = i; k < i + 4 && k < count; k++) {
+                dst[k] = k < src_limit ? src[k] : 0;
+            }
+        }
+    }
+}
+
+// Local-memory tiled NCC. Each work-group cooperatively stages a block of template
+// rows plus the matching search tile (output tile plus template apron) in __local
+// memory, and each work-item computes TILED_OUTPUTS neighbouring outputs from it with
+// uchar16 vector loads. The template is processed in blocks of `block_rows` rows so
+// that large templates fit in local memory; the host picks the block height and the
+// work-group shape (tile = local_size(0) * TILED_OUTPUTS by local_size(1) outputs).
+//
+// Dot products are accumulated in integers, and the zero-mean numerator is formed as
+// n * sum(t * s) - sum(t) * sum(s) with the window sum taken from the integral image.
+__kernel void tiled_ncc_tracker(
+    __global const uchar* template_img,
+    __global const uchar* search_region,
+    __global const uint* integral_sum,
+    __global const ulong* integral_sqsum,
+    __global float* correlation_map,
+    __local uchar* template_tile,
+    __local uchar* search_tile,
+    const int template_width_arg,
+    const int template_height_arg,
+    const int search_width,
+    const int search_height,
+    const int channels_arg,
+    const int template_sum,
+    const float template_norm,
+    const int block_rows
+) {
+    const int template_width = SPECIALISED_WIDTH(template_width_arg);
+    const int template_height = SPECIALISED_HEIGHT(template_height_arg);
+    const int channels = SPECIALISED_CHANNELS(channels_arg);
+    int lx = get_local_id(0);
+    int ly = get_local_id(1);
+    int flat_id = ly * get_local_size(0) + lx;
+    int group_size = get_local_size(0) * get_local_size(1);
+    
+    int tile_width = get_local_size(0) * TILED_OUTPUTS;
+    int tile_height = get_local_size(1);
+    int tile_x = get_group_id(0) * tile_width;
+    int tile_y = get_group_id(1) * tile_height;
+    
+    int out_x = tile_x + lx * TILED_OUTPUTS;
+    int out_y = tile_y + ly;
+    int corr_width = search_width - template_width;
+    int corr_height = search_height - template_height;
+    
+    int row_length = template_width * channels;
+    int tile_row_bytes = (tile_width + template_width - 1) * channels;
+    int tile_pitch = (tile_row_bytes + 3) & ~3;
+    int search_bytes = search_width * search_height * channels;
+    int template_bytes = row_length * template_height;
+    
+    ulong acc[TILED_OUTPUTS];
+    for (int k = 0; k < TILED_OUTPUTS; k++) {
+        acc[k] = 0;
+    }
+    
+    for (int ty0 = 0; ty0 < template_height; ty0 += block_rows) {
+        int rows = min(block_rows, template_height - ty0);
+        
+        // Stage template rows [ty0, ty0 + rows)
+        int template_offset = ty0 * row_length;
+        load_bytes_to_local(template_img + template_offset, template_tile, rows * row_length,
+                            template_bytes - template_offset, flat_id, group_size);
+        
+        // Stage the search rows those template rows touch, one padded row at a time
+        int search_rows = tile_height + rows - 1;
+        for (int r = 0; r < search_rows; r++) {
+            int gy = tile_y + ty0 + r;
+            int src_offset = (gy * search_width + tile_x) * channels;
+            int src_limit = gy < search_height ? search_bytes - src_offset : 0;
+            load_bytes_to_local(search_region + src_offset, search_tile + r * tile_pitch,
+                                tile_row_bytes, src_limit, flat_id, group_size);
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+        
+        if (out_y < corr_height) {
+            for (int r = 0; r < rows; r++) {
+                __local const uchar* template_row = template_tile + r * row_length;
+                __local const uchar* search_row = search_tile + (ly + r) * tile_pitch + lx * TILED_OUTPUTS * channels;
+                
+                uint row_acc[TILED_OUTPUTS];
+                for (int k = 0; k < TILED_OUTPUTS; k++) {
+                    row_acc[k] = 0;
+                }
+                
+                int i = 0;
+                for (; i + 16 <= row_length; i += 16) {
+                    uint16 t = convert_uint16(vload16(0, template_row + i));
+                    for (int k = 0; k < TILED_OUTPUTS; k++) {
+                        uint16 s = convert_uint16(vload16(0, search_row + k * channels + i));
+                        row_acc[k] += sum_uint16(t * s);
+                    }
+                }
+                for (; i < row_length; i++) {
+                    uint t = template_row[i];
+                    for (int k = 0; k < TILED_OUTPUTS; k++) {
+                        row_acc[k] += t * search_row[k * channels + i];
+                    }
+                }
+                
+                for (int k = 0; k < TILED_OUTPUTS; k++) {
+                    acc[k] += row_acc[k];
+                }
+            }
+        }
+        
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    
+    if (out_y >= corr_height) {
+        return;
+    }
+    
+    int stride = search_width + 1;
+    int y1 = out_y + template_height;
+    long total_pixels = (long)template_width * template_height * channels;
+    
+    for (int k = 0; k < TILED_OUTPUTS; k++) {
+        int x = out_x + k;
+        if (x >= corr_width) {
+            break;
+        }
+        int x1 = x + template_width;
+        
+        uint window_sum = integral_sum[y1 * stride + x1] - integral_sum[out_y * stride + x1]
+                        - integral_sum[y1 * stride + x] + integral_sum[out_y * stride + x];
+        ulong window_sqsum = integral_sqsum[y1 * stride + x1] - integral_sqsum[out_y * stride + x1]
+                           - integral_sqsum[y1 * stride + x] + integral_sqsum[out_y * stride + x];
+        
+        long scaled_numerator = total_pixels * (long)acc[k] - (long)template_sum * (long)window_sum;
+        long scaled_var = total_pixels * (long)window_sqsum - (long)window_sum * (long)window_sum;
+        float numerator = convert_float(scaled_numerator) / convert_float(total_pixels);
+        float search_var = convert_float(scaled_var) / convert_float(total_pixels);
+        
+        float correlation = 0.0f;
+        if (template_norm > 1e-3f && search_var > 1e-6f) {
+            correlation = numerator / (template_norm * sqrt(search_var));
+            correlation = (correlation + 1.0f) * 0.5f;
+        }
+        
+        correlation_map[out_y * corr_width + x] = correlation;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Frequency-domain correlation
+//
+// An interleaved image of width W with C channels is treated as a single-channel
+// image of width W * C; correlating it with a template of width Tw * C and keeping
+// every C-th column gives exactly the channel-summed correlation used above.
+// Images are zero-padded to power-of-two sizes and stored as float2 (re, im).
+// ---------------------------------------------------------------------------
+
+// Pack interleaved bytes into a zero-padded complex buffer, subtracting `offset`
+// from every sample to reduce the dynamic range seen by the FFT. Correlating with a
+// zero-mean template is unaffected by a constant offset.
+__kernel void fft_pack_bytes(
+    __global const uchar* src,
+    __global float2* dst,
+    const int row_length,
+    const int rows,
+    const int padded_width,
+    const float offset
+) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    
+    float value = 0.0f;
+    if (x < row_length && y < rows) {
+        value = convert_float(src[y * row_length + x]) - offset;
+    }
+    dst[y * padded_width + x] = (float2)(value, 0.0f);
+}
+
+__kernel void fft_pack_floats(
+    __global const float* src,
+    __global float2* dst,
+    const int row_length,
+    const int rows,
+    const int padded_width
+) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    
+    float value = 0.0f;
+    if (x < row_length && y < rows) {
+        value = src[y * row_length + x];
+    }
+    dst[y * padded_width + x] = (float2)(value, 0.0f);
+}
+
+// One radix-2 Stockham pass over a batch of 1D transforms of length n. Work-item
+// (i, b) handles butterfly i of transform b; p doubles from 1 to n / 2 over
+// log2(n) passes and the result ends up in natural order. `element_stride` and
+// `batch_stride` select rows (1, width) or columns (width, 1) of a 2D buffer.
+// direction is -1 for the forward and +1 for the inverse (unscaled) transform.
+__kernel void fft_radix2(
+    __global const float2* src,
+    __global float2* dst,
+    const int n,
+    const int p,
+    const int element_stride,
+    const int batch_stride,
+    const float direction
+) {
+    int i = get_global_id(0);
+    int b = get_global_id(1);
+    int half_n = n >> 1;
+    
+    __global const float2* in = src + b * batch_stride;
+    __global float2* out = dst + b * batch_stride;
+    
+    int k = i & (p - 1);
+    float2 u0 = in[i * element_stride];
+    float2 u1 = in[(i + half_n) * element_stride];
+    
+    float cos_angle;
+    float sin_angle = sincos(direction * M_PI_F * k / p, &cos_angle);
+    u1 = (float2)(u1.x * cos_angle - u1.y * sin_angle,
+                  u1.x * sin_angle + u1.y * cos_angle);
+    
+    int j = (i << 1) - k;
+    out[j * element_stride] = u0 + u1;
+    out[(j + p) * element_stride] = u0 - u1;
+}
+
+// Cross-correlation in the frequency domain: spectrum = search * conj(template)
+__kernel void fft_multiply_conj(
+    __global float2* spectrum,
+    __global const float2* template_spectrum
+) {
+    int i = get_global_id(0);
+    float2 s = spectrum[i];
+    float2 t = template_spectrum[i];
+    spectrum[i] = (float2)(s.x * t.x + s.y * t.y,
+                           s.y * t.x - s.x * t.y);
+}
+
+// Turn the inverse-transformed correlation into the same normalised score as the
+// spatial kernels, using the integral images for the window statistics.
+__kernel void fft_ncc_normalize(
+    __global const float2* correlation,
+    __global const uint* integral_sum,
+    __global const ulong* integral_sqsum,
+    __global float* correlation_map,
+    const int template_width,
+    const int template_height,
+    const int search_width,
+    const int search_height,
+    const int channels,
+    const int padded_width,
+    const float inverse_scale,
+    const float template_norm
+) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    
+    if (x >= search_width - template_width || y >= search_height - template_height) {
+        return;
+    }
+    
+    float numerator = correlation[y * padded_width + x * channels].x * inverse_scale;
+    
+    int stride = search_width + 1;
+    int x1 = x + template_width;
+    int y1 = y + template_height;
+    
+    uint window_sum = integral_sum[y1 * stride + x1] - integral_sum[y * stride + x1]
+                    - integral_sum[y1 * stride + x] + integral_sum[y * stride + x];
+    ulong window_sqsum = integral_sqsum[y1 * stride + x1] - integral_sqsum[y * stride + x1]
+                       - integral_sqsum[y1 * stride + x] + integral_sqsum[y * stride + x];
+    
+    long total_pixels = (long)template_width * template_height * channels;
+    long scaled_var = total_pixels * (long)window_sqsum - (long)window_sum * (long)window_sum;
+    float search_var = convert_float(scaled_var) / convert_float(total_pixels);
+    
+    float ncc = 0.0f;
+    if (template_norm > 1e-3f && search_var > 1e-6f) {
+        ncc = numerator / (template_norm * sqrt(search_var));
+        ncc = (clamp(ncc, -1.0f, 1.0f) + 1.0f) * 0.5f;
+    }
+    
+    correlation_map[y * (search_width - template_width) + x] = ncc;
+}
+
+// ---------------------------------------------------------------------------
+// Coarse-to-fine pyramid search
+// ---------------------------------------------------------------------------
+
+// Halve an interleaved image with a rounded 2x2 box filter. Odd trailing rows and
+// columns are dropped, matching the host-side template pyramid.
+__kernel void downsample2x(
+    __global const uchar* src,
+    __global uchar* dst,
+    const int src_width,
+    const int dst_width,
+    const int dst_height,
+    const int channels
+) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    
+    if (x >= dst_width || y >= dst_height) {
+        return;
+    }
+    
+    __global const uchar* top = src + ((2 * y) * src_width + 2 * x) * channels;
+    __global const uchar* bottom = top + src_width * channels;
+    __global uchar* out = dst + (y * dst_width + x) * channels;
+    
+    for (int ch = 0; ch < channels; ch++) {
+        uint sum = top[ch] + top[channels + ch] + bottom[ch] + bottom[channels + ch];
+        out[ch] = (uchar)((sum + 2) >> 2);
+    }
+}
+
+// NCC over a rectangular window of candidate positions only, with the window
+// statistics accumulated in the same single pass as the dot product. Used for the
+// full search at the coarsest level and the small refinement windows below it.
+__kernel void ncc_window_search(
+    __global const float* template_zm,
+    __global const uchar* search_region,
+    __global float* scores,
+    const int template_width,
+    const int template_height,
+    const int search_width,
+    const int channels,
+    const int window_x,
+    const int window_y,
+    const int window_width,
+    const int window_height,
+    const float template_norm
+) {
+    int wx = get_global_id(0);
+    int wy = get_global_id(1);
+    
+    if (wx >= window_width || wy >= window_height) {
+        return;
+    }
+    
+    int x = window_x + wx;
+    int y = window_y + wy;
+    int row_length = template_width * channels;
+    
+    float numerator = 0.0f;
+    uint window_sum = 0;
+    ulong window_sqsum = 0;
+    
+    for (int ty = 0; ty < template_height; ty++) {
+        __global const float* template_row = template_zm + ty * row_length;
+        __global const uchar* search_row = search_region + ((y + ty) * search_width + x) * channels;
+        
+        uint row_sqsum = 0;
+        for (int i = 0; i < row_length; i++) {
+            uint value = search_row[i];
+            numerator += template_row[i] * convert_float(value);
+            window_sum += value;
+            row_sqsum += value * value;
+        }
+        window_sqsum += row_sqsum;
+    }
+    
+    long total_pixels = (long)row_length * template_height;
+    long scaled_var = total_pixels * (long)window_sqsum - (long)window_sum * (long)window_sum;
+    float search_var = convert_float(scaled_var) / convert_float(total_pixels);
+    
+    float correlation = 0.0f;
+    if (template_norm > 1e-3f && search_var > 1e-6f) {
+        correlation = numerator / (template_norm * sqrt(search_var));
+        correlation = (correlation + 1.0f) * 0.5f;
+    }
+    
+    scores[wy * window_width + wx] = correlation;
+}
+
+// ---------------------------------------------------------------------------
+// On-device argmax of a score map
+// ---------------------------------------------------------------------------
+
+// Ties go to the lower index, matching a sequential scan of the map
+inline bool argmax_better(float score, int index, float best_score, int best_index) {
+    return score > best_score || (score == best_score && index < best_index);
+}
+
+// Tree reduction of the per-work-item bests held in local memory
+inline void argmax_reduce_local(__local float* local_scores, __local int* local_indices) {
+    int lid = get_local_id(0);
+    
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (int offset = get_local_size(0) >> 1; offset > 0; offset >>= 1) {
+        if (lid < offset &&
+            argmax_better(local_scores[lid + offset], local_indices[lid + offset],
+                          local_scores[lid], local_indices[lid])) {
+            local_scores[lid] = local_scores[lid + offset];
+            local_indices[lid] = local_indices[lid + offset];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+}
+
+// Stage 1: work-group g reduces the contiguous chunk [g * chunk_size, (g + 1) * chunk_size)
+// of the map to its best (score, index) pair. Because chunks are contiguous bands of
+// rows, the partial results double as one peak per band. Local size must be a power of two.
+__kernel void argmax_partial(
+    __global const float* scores,
+    __global float* partial_scores,
+    __global int* partial_indices,
+    __local float* local_scores,
+    __local int* local_indices,
+    const int count,
+    const int chunk_size
+) {
+    int lid = get_local_id(0);
+    int group = get_group_id(0);
+    int begin = group * chunk_size;
+    int end = min(begin + chunk_size, count);
+    
+    float best_score = -INFINITY;
+    int best_index = INT_MAX;
+    for (int i = begin + lid; i < end; i += get_local_size(0)) {
+        float score = scores[i];
+        if (argmax_better(score, i, best_score, best_index)) {
+            best_score = score;
+            best_index = i;
+        }
+    }
+    
+    local_scores[lid] = best_score;
+    local_indices[lid] = best_index;
+    argmax_reduce_local(local_scores, local_indices);
+    
+    if (lid == 0) {
+        partial_scores[group] = local_scores[0];
+        partial_indices[group] = local_indices[0];
+    }
+}
+
+// Stage 2: one work-group reduces the partial results. result[0] holds the bits of the
+// best score and result[1] its index, so the host reads back eight bytes.
+__kernel void argmax_final(
+    __global const float* partial_scores,
+    __global const int* partial_indices,
+    __global int* result,
+    __local float* local_scores,
+    __local int* local_indices,
+    const int count
+) {
+    int lid = get_local_id(0);
+    
+    float best_score = -INFINITY;
+    int best_index = INT_MAX;
+    for (int i = lid; i < count; i += get_local_size(0)) {
+        if (argmax_better(partial_scores[i], partial_indices[i], best_score, best_index)) {
+            best_score = partial_scores[i];
+            best_index = partial_indices[i];
+        }
+    }
+    
+    local_scores[lid] = best_score;
+    local_indices[lid] = best_index;
+    argmax_reduce_local(local_scores, local_indices);
+    
+    if (lid == 0) {
+        result[0] = as_int(local_scores[0]);
+        result[1] = local_indices[0];
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Top-K peaks of a score map with non-maximum suppression
+//
+// A peak is a local maximum of its 3x3 neighbourhood. Peaks are picked greedily, best
+// first, skipping any within `radius` (Chebyshev distance) of one already picked.
+// Each work-group picks up to k peaks from its chunk of the map, then one work-group
+// merges the per-group lists with the same rule, so the host reads back one short list.
+// ---------------------------------------------------------------------------
+
+// Most peaks per list, must match kMaxTopK on the host
+#define TOPK_MAX 16
+
+inline bool topk_is_local_max(__global const float* scores, int index, int width, int height) {
+    int x = index % width;
+    int y = index / width;
+    float score = scores[index];
+    for (int dy = -1; dy <= 1; dy++) {
+        int ny = y + dy;
+        if (ny < 0 || ny >= height) {
+            continue;
+        }
+        for (int dx = -1; dx <= 1; dx++) {
+            int nx = x + dx;
+            if (nx < 0 || nx >= width || (dx == 0 && dy == 0)) {
+                continue;
+            }
+            if (scores[ny * width + nx] > score) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// True when index lies within radius of one of the first `count` picked peaks
+inline bool topk_suppressed(int index, __local const int* picked, int count, int width, int radius) {
+    int x = index % width;
+    int y = index / width;
+    for (int i = 0; i < count; i++) {
+        if (abs(x - picked[i] % width) <= radius && abs(y - picked[i] / width) <= radius) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Stage 1: work-group g picks up to k peaks from the chunk [g * chunk_size, (g + 1) * chunk_size)
+// and writes them best first to slots [g * TOPK_MAX, (g + 1) * TOPK_MAX); unused slots get
+// index -1. Neighbours outside the chunk are still read, so chunk borders hold no false peaks.
+__kernel void topk_partial(
+    __global const float* scores,
+    __global float* candidate_scores,
+    __global int* candidate_indices,
+    __local float* local_scores,
+    __local int* local_indices,
+    const int width,
+    const int height,
+    const int chunk_size,
+    const int k,
+    const int radius
+) {
+    __local int picked[TOPK_MAX];
+    
+    int lid = get_local_id(0);
+    int group = get_group_id(0);
+    int begin = group * chunk_size;
+    int end = min(begin + chunk_size, width * height);
+    
+    int picked_count = 0;
+    while (picked_count < k) {
+        float best_score = -INFINITY;
+        int best_index = INT_MAX;
+        for (int i = begin + lid; i < end; i += get_local_size(0)) {
+            float score = scores[i];
+            if (argmax_better(score, i, best_score, best_index) &&
+                !topk_suppressed(i, picked, picked_count, width, radius) &&
+                topk_is_local_max(scores, i, width, height)) {
+                best_score = score;
+                best_index = i;
+            }
+        }
+        
+        local_scores[lid] = best_score;
+        local_indices[lid] = best_index;
+        argmax_reduce_local(local_scores, local_indices);
+        
+        float peak_score = local_scores[0];
+        int peak_index = local_indices[0];
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (peak_index == INT_MAX) {
+            break;
+        }
+        if (lid == 0) {
+            picked[picked_count] = peak_index;
+            candidate_scores[group * TOPK_MAX + picked_count] = peak_score;
+            candidate_indices[group * TOPK_MAX + picked_count] = peak_index;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        picked_count++;
+    }
+    
+    for (int i = picked_count + lid; i < TOPK_MAX; i += get_local_size(0)) {
+        candidate_scores[group * TOPK_MAX + i] = -INFINITY;
+        candidate_indices[group * TOPK_MAX + i] = -1;
+    }
+}
+
+// Stage 2: one work-group merges the candidate lists. result holds k pairs of score bits
+// and map index, best first, with index -1 after the last peak found.
+__kernel void topk_final(
+    __global const float* candidate_scores,
+    __global const int* candidate_indices,
+    __global int* result,
+    __local float* local_scores,
+    __local int* local_indices,
+    const int candidate_count,
+    const int width,
+    const int k,
+    const int radius
+) {
+    __local int picked[TOPK_MAX];
+    
+    int lid = get_local_id(0);
+    
+    int picked_count = 0;
+    while (picked_count < k) {
+        float best_score = -INFINITY;
+        int best_index = INT_MAX;
+        for (int i = lid; i < candidate_count; i += get_local_size(0)) {
+            int index = candidate_indices[i];
+            if (index >= 0 &&
+                argmax_better(candidate_scores[i], index, best_score, best_index) &&
+                !topk_suppressed(index, picked, picked_count, width, radius)) {
+                best_score = candidate_scores[i];
+                best_index = index;
+            }
+        }
+        
+        local_scores[lid] = best_score;
+        local_indices[lid] = best_index;
+        argmax_reduce_local(local_scores, local_indices);
+        
+        float peak_score = local_scores[0];
+        int peak_index = local_indices[0];
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (peak_index == INT_MAX) {
+            break;
+        }
+        if (lid == 0) {
+            picked[picked_count] = peak_index;
+            result[2 * picked_count] = as_int(peak_score);
+            result[2 * picked_count + 1] = peak_index;
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+        picked_count++;
+    }
+    
+    for (int i = picked_count + lid; i < k; i += get_local_size(0)) {
+        result[2 * i] = as_int(-INFINITY);
+        result[2 * i + 1] = -1;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Batched multi-target tracking
+//
+// All targets share packed buffers: zero-mean templates, search ROIs and score maps
+// are concatenated, and each target is described by TARGET_DESC_STRIDE ints:
+//   [0] template offset (floats)   [1] template width   [2] template height
+//   [3] search offset (bytes)      [4] search width     [5] search height
+//   [6] score offset (floats)      [7] template norm (float bits)
+// ---------------------------------------------------------------------------
+
+#define TARGET_DESC_STRIDE 8
+
+// Work-item (x, y, t) scores candidate (x, y) of target t. The grid is sized for the
+// largest correlation map; items outside a smaller target's map return immediately.
+__kernel void batched_ncc_tracker(
+    __global const float* templates_zm,
+    __global const uchar* search_regions,
+    __global const int* descriptors,
+    __global float* scores,
+    const int channels
+) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    __global const int* desc = descriptors + get_global_id(2) * TARGET_DESC_STRIDE;
+    
+    int template_width = desc[1];
+    int template_height = desc[2];
+    int search_width = desc[4];
+    int corr_width = search_width - template_width;
+    int corr_height = desc[5] - template_height;
+    
+    if (x >= corr_width || y >= corr_height) {
+        return;
+    }
+    
+    __global const float* template_zm = templates_zm + desc[0];
+    __global const uchar* search_region = search_regions + desc[3];
+    float template_norm = as_float(desc[7]);
+    int row_length = template_width * channels;
+    
+    float numerator = 0.0f;
+    uint window_sum = 0;
+    ulong window_sqsum = 0;
+    
+    for (int ty = 0; ty < template_height; ty++) {
+        __global const float* template_row = template_zm + ty * row_length;
+        __global const uchar* search_row = search_region + ((y + ty) * search_width + x) * channels;
+        
+        uint row_sqsum = 0;
+        for (int i = 0; i < row_length; i++) {
+            uint value = search_row[i];
+            numerator += template_row[i] * convert_float(value);
+            window_sum += value;
+            row_sqsum += value * value;
+        }
+        window_sqsum += row_sqsum;
+    }
+    
+    long total_pixels = (long)row_length * template_height;
+    long scaled_var = total_pixels * (long)window_sqsum - (long)window_sum * (long)window_sum;
+    float search_var = convert_float(scaled_var) / convert_float(total_pixels);
+    
+    float correlation = 0.0f;
+    if (template_norm > 1e-3f && search_var > 1e-6f) {
+        correlation = numerator / (template_norm * sqrt(search_var));
+        correlation = (correlation + 1.0f) * 0.5f;
+    }
+    
+    scores[desc[6] + y * corr_width + x] = correlation;
+}
+
+// One work-group per target reduces that target's score map. results[2t] holds the bits
+// of the best score and results[2t + 1] its index within the target's map (-1 if the
+// map is empty). Local size must be a power of two.
+__kernel void batched_argmax(
+    __global const float* scores,
+    __global const int* descriptors,
+    __global int* results,
+    __local float* local_scores,
+    __local int* local_indices
+) {
+    int lid = get_local_id(0);
+    int target = get_group_id(0);
+    __global const int* desc = descriptors + target * TARGET_DESC_STRIDE;
+    
+    int count = max(0, desc[4] - desc[1]) * max(0, desc[5] - desc[2]);
+    __global const float* target_scores = scores + desc[6];
+    
+    float best_score = -INFINITY;
+    int best_index = INT_MAX;
+    for (int i = lid; i < count; i += get_local_size(0)) {
+        float score = target_scores[i];
+        if (argmax_better(score, i, best_score, best_index)) {
+            best_score = score;
+            best_index = i;
+        }
+    }
+    
+    local_scores[lid] = best_score;
+    local_indices[lid] = best_index;
+    argmax_reduce_local(local_scores, local_indices);
+    
+    if (lid == 0) {
+        results[2 * target] = as_int(local_scores[0]);
+        results[2 * target + 1] = count > 0 ? local_indices[0] : -1;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Single-channel (luma) tracking
+// ---------------------------------------------------------------------------
+
+// NCC specialised for 8-bit luma. Template and search rows are contiguous bytes, so
+// the dot product runs on packed uchar16 loads with exact integer accumulation; the
+// window statistics come from the integral images as in tiled_ncc_tracker.
+__kernel void grayscale_ncc_tracker(
+    __global const uchar* template_img,
+    __global const uchar* search_region,
+    __global const uint* integral_sum,
+    __global const ulong* integral_sqsum,
+    __global float* correlation_map,
+    const int template_width_arg,
+    const int template_height_arg,
+    const int search_width,
+    const int search_height,
+    const int template_sum,
+    const float template_norm
+) {
+    const int template_width = SPECIALISED_WIDTH(template_width_arg);
+    const int template_height = SPECIALISED_HEIGHT(template_height_arg);
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    
+    if (x >= search_width - template_width || y >= search_height - template_height) {
+        return;
+    }
+    
+    ulong dot = 0;
+    for (int ty = 0; ty < template_height; ty++) {
+        __global const uchar* template_row = template_img + ty * template_width;
+        __global const uchar* search_row = search_region + (y + ty) * search_width + x;
+        
+        uint row_dot = 0;
+        int i = 0;
+        for (; i + 16 <= template_width; i += 16) {
+            uint16 t = convert_uint16(vload16(0, template_row + i));
+            uint16 s = convert_uint16(vload16(0, search_row + i));
+            row_dot += sum_uint16(t * s);
+        }
+        for (; i < template_width; i++) {
+            row_dot += (uint)template_row[i] * search_row[i];
+        }
+        dot += row_dot;
+    }
+    
+    int stride = search_width + 1;
+    int x1 = x + template_width;
+    int y1 = y + template_height;
+    
+    uint window_sum = integral_sum[y1 * stride + x1] - integral_sum[y * stride + x1]
+                    - integral_sum[y1 * stride + x] + integral_sum[y * stride + x];
+    ulong window_sqsum = integral_sqsum[y1 * stride + x1] - integral_sqsum[y * stride + x1]
+                       - integral_sqsum[y1 * stride + x] + integral_sqsum[y * stride + x];
+    
+    long total_pixels = (long)template_width * template_height;
+    long scaled_numerator = total_pixels * (long)dot - (long)template_sum * (long)window_sum;
+    long scaled_var = total_pixels * (long)window_sqsum - (long)window_sum * (long)window_sum;
+    float numerator = convert_float(scaled_numerator) / convert_float(total_pixels);
+    float search_var = convert_float(scaled_var) / convert_float(total_pixels);
+    
+    float correlation = 0.0f;
+    if (template_norm > 1e-3f && search_var > 1e-6f) {
+        correlation = numerator / (template_norm * sqrt(search_var));
+        correlation = (correlation + 1.0f) * 0.5f;
+    }
+    
+    correlation_map[y * (search_width - template_width) + x] = correlation;
+}
+
+// ---------------------------------------------------------------------------
+// Template adaptation
+// ---------------------------------------------------------------------------
+
+// Blends the template-sized patch at patch_offset of the source (rows of
+// source_row_length elements) into the running template and rebuilds everything
+// derived from it in the same launch: the rounded byte template, the zero-mean float
+// template, and the integer sum and sum of squares in stats[2 * stats_index + 0/1].
+// reset_accumulator seeds the float accumulator from the byte template first.
+// With a null accumulator the patch is taken as is, which is how downsampled pyramid
+// levels get their zero-mean templates. Runs as one work-group whose local size is a
+// power of two.
+__kernel void template_update(
+    __global const uchar* source,
+    const int source_row_length,
+    const int patch_offset,
+    __global float* accumulator,
+    __global uchar* template_bytes,
+    __global float* template_zm,
+    __global ulong* stats,
+    __local ulong* local_sums,
+    __local ulong* local_sqsums,
+    const int row_length,
+    const int rows,
+    const float rate,
+    const int reset_accumulator,
+    const int stats_index
+) {
+    int lid = get_local_id(0);
+    int local_size = get_local_size(0);
+    int count = row_length * rows;
+    
+    ulong sum = 0;
+    ulong sqsum = 0;
+    for (int i = lid; i < count; i += local_size) {
+        int row = i / row_length;
+        uint value = source[patch_offset + row * source_row_length + (i - row * row_length)];
+        if (accumulator) {
+            float blended = reset_accumulator ? convert_float(template_bytes[i]) : accumulator[i];
+            blended = mad(rate, convert_float(value) - blended, blended);
+            accumulator[i] = blended;
+            value = convert_uchar_sat_rte(blended);
+            template_bytes[i] = (uchar)value;
+        }
+        sum += value;
+        sqsum += value * value;
+    }
+    
+    local_sums[lid] = sum;
+    local_sqsums[lid] = sqsum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (int offset = local_size / 2; offset > 0; offset >>= 1) {
+        if (lid < offset) {
+            local_sums[lid] += local_sums[lid + offset];
+            local_sqsums[lid] += local_sqsums[lid + offset];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    long total = (long)local_sums[0];
+    
+    // Each work-item revisits the elements it wrote above, so no global barrier is needed
+    for (int i = lid; i < count; i += local_size) {
+        long value;
+        if (accumulator) {
+            value = template_bytes[i];
+        } else {
+            int row = i / row_length;
+            value = source[patch_offset + row * source_row_length + (i - row * row_length)];
+        }
+        template_zm[i] = convert_float(value * count - total) / convert_float(count);
+    }
+    
+    if (lid == 0) {
+        stats[2 * stats_index] = local_sums[0];
+        stats[2 * stats_index + 1] = local_sqsums[0];
+    }
+}
@@ -0,0 +1,324 @@
+// Synthetic tracker benchmark: drives the tracker backends over a moving texture and
+// reports latency, throughput and per-frame work without a camera or framebuffer.
+//
+//   tracker_bench [--format=csv|json] [--output=PATH] [--frames=N] [--warmup=N]
+//                 [--backend=all|opencl|native] [--quick]
+#include "tracker_backend.h"
+#include "tracker.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int kFrameWidth = 1920;
+const int kFrameHeight = 1080;
+
+// The camera pans along a circle over a larger texture; the target is fixed in the texture
+const int kPanRadius = 60;
+const double kPanStep = 0.05;
+
+struct BenchConfig {
+    std::string backend;        // "opencl" or "native"
+    std::string variant;        // kernel variant for OpenCL, "simd" for native
+    int template_size;
+    int search_margin;
+    int channels;
+};
+
+struct BenchResult {
+    BenchConfig config;
+    int frames;
+    double median_ms;
+    double p99_ms;
+    double mean_ms;
+    double fps;
+    double bytes_per_frame;
+    double flops_per_frame;
+    double mean_error_px;
+    int lost_frames;
+};
+
+struct Options {
+    std::string format;
+    std::string output;
+    int frames;
+    int warmup;
+    std::string backend;
+    bool quick;
+};
+
+cv::Mat makeTexture() {
+    cv::Mat texture(kFrameHeight + 2 * kPanRadius + 2, kFrameWidth + 2 * kPanRadius + 2, CV_8UC3);
+    cv::RNG rng(12345);
+    rng.fill(texture, cv::RNG::UNIFORM, cv::Scalar(0, 0, 0), cv::Scalar(256, 256, 256));
+    
+    // Blur so the correlation peak is a few pixels wide, as with real imagery
+    cv::GaussianBlur(texture, texture, cv::Size(5, 5), 1.5);
+    return texture;
+}
+
+cv::Point panOffset(int frame_index) {
+    double angle = frame_index * kPanStep;
+    return cv::Point(kPanRadius + 1 + static_cast<int>(std::lround(kPanRadius * std::cos(angle))),
+                     kPanRadius + 1 + static_cast<int>(std::lround(kPanRadius * std::sin(angle))));
+}
+
+cv::Mat frameAt(const cv::Mat& texture, int frame_index) {
+    cv::Point offset = panOffset(frame_index);
+    return texture(cv::Rect(offset.x, offset.y, kFrameWidth, kFrameHeight));
+}
+
+double percentile(std::vector<double> values, double fraction) {
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(std::ceil(fraction * values.size()));
+    return values[std::min(values.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+// Applies the kernel variant to an OpenCL tracker; false if the device lacks it
+bool applyVariant(TrackerBackend* backend, const std::string& variant) {
+    VisualTracker* tracker = dynamic_cast<VisualTracker*>(backend);
+    if (!tracker) {
+        return true;
+    }
+    
+    NccMethod method = NccMethod::Tiled;
+    if (variant == "direct") {
+        method = NccMethod::Direct;
+    } else if (variant == "integral") {
+        method = NccMethod::Integral;
+    } else if (variant == "fft") {
+        method = NccMethod::Fft;
+    }
+    
+    tracker->setFftAutoSwitch(false);
+    tracker->setSpecialisedKernels(variant != "tiled-generic");
+    tracker->setNccMethod(method);
+    return tracker->getNccMethod() == method;
+}
+
+bool runConfig(TrackerBackend* backend, const cv::Mat& texture, const BenchConfig& config,
+               const Options& options, BenchResult& result) {
+    if (!applyVariant(backend, config.variant)) {
+        std::cerr << "Skipping unsupported variant " << config.backend << "/" << config.variant << std::endl;
+        return false;
+    }
+    backend->setColorMode(config.channels == 1 ? ColorMode::Gray : ColorMode::Bgr);
+    
+    // Target starts in the middle of the first frame
+    cv::Point target(kFrameWidth / 2, kFrameHeight / 2);
+    int half = config.template_size / 2;
+    backend->setTemplate(frameAt(texture, 0)(cv::Rect(target.x - half, target.y - half,
+                                                      config.template_size, config.template_size)));
+    cv::Point texture_target = target + panOffset(0);
+    
+    std::vector<double> latencies;
+    double error_sum = 0.0;
+    int lost = 0;
+    cv::Point track_point = target;
+    int search_size = config.search_margin * 2;
+    
+    for (int i = 1; i <= options.warmup + options.frames; i++) {
+        cv::Mat frame = frameAt(texture, i);
+        cv::Rect search_roi(track_point.x - config.search_margin, track_point.y - config.search_margin,
+                            search_size, search_size);
+        search_roi &= cv::Rect(0, 0, frame.cols, frame.rows);
+        cv::Mat search_region = frame(search_roi);
+        
+        cv::Point location;
+        float confidence = 0.0f;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool success = backend->track(search_region, location, confidence);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        
+        if (success) {
+            track_point = location + search_roi.tl();
+        }
+        if (i <= options.warmup) {
+            continue;
+        }
+        
+        latencies.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        cv::Point truth = texture_target - panOffset(i);
+        error_sum += std::hypot(track_point.x - truth.x, track_point.y - truth.y);
+        if (!success) {
+            lost++;
+        }
+    }
+    
+    double total_ms = 0.0;
+    for (size_t i = 0; i < latencies.size(); i++) {
+        total_ms += latencies[i];
+    }
+    
+    // Work of one frame: bytes that actually move (the search upload plus the eight-byte
+    // argmax result on OpenCL, the search bytes read on the native backend), and one
+    // multiply-add per template element per candidate position
+    double corr_positions = static_cast<double>(search_size - config.template_size) *
+                            (search_size - config.template_size);
+    double template_elements = static_cast<double>(config.template_size) * config.template_size * config.channels;
+    
+    result.config = config;
+    result.frames = options.frames;
+    result.median_ms = percentile(latencies, 0.5);
+    result.p99_ms = percentile(latencies, 0.99);
+    result.mean_ms = total_ms / latencies.size();
+    result.fps = result.mean_ms > 0.0 ? 1000.0 / result.mean_ms : 0.0;
+    double search_bytes = static_cast<double>(search_size) * search_size * config.channels;
+    result.bytes_per_frame = config.backend == "opencl" ? search_bytes + 2 * sizeof(int) : search_bytes;
+    result.flops_per_frame = 2.0 * corr_positions * template_elements;
+    result.mean_error_px = error_sum / options.frames;
+    result.lost_frames = lost;
+    return true;
+}
+
+void writeCsv(std::ostream& out, const std::vector<BenchResult>& results) {
+    out << "backend,variant,template,margin,channels,frames,median_ms,p99_ms,mean_ms,fps,"
+        << "bytes_per_frame,flops_per_frame,mean_error_px,lost_frames\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << r.config.backend << "," << r.config.variant << "," << r.config.template_size << ","
+            << r.config.search_margin << "," << r.config.channels << "," << r.frames << ","
+            << r.median_ms << "," << r.p99_ms << "," << r.mean_ms << "," << r.fps << ","
+            << r.bytes_per_frame << "," << r.flops_per_frame << "," << r.mean_error_px << ","
+            << r.lost_frames << "\n";
+    }
+}
+
+void writeJson(std::ostream& out, const std::vector<BenchResult>& results) {
+    out << "[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << "  {\"backend\": \"" << r.config.backend << "\", \"variant\": \"" << r.config.variant
+            << "\", \"template\": " << r.config.template_size << ", \"margin\": " << r.config.search_margin
+            << ", \"channels\": " << r.config.channels << ", \"frames\": " << r.frames
+            << ", \"median_ms\": " << r.median_ms << ", \"p99_ms\": " << r.p99_ms
+            << ", \"mean_ms\": " << r.mean_ms << ", \"fps\": " << r.fps
+            << ", \"bytes_per_frame\": " << r.bytes_per_frame << ", \"flops_per_frame\": " << r.flops_per_frame
+            << ", \"mean_error_px\": " << r.mean_error_px << ", \"lost_frames\": " << r.lost_frames << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    options.format = "csv";
+    options.frames = 200;
+    options.warmup = 10;
+    options.backend = "all";
+    options.quick = false;
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        
+        if (key == "--format" && (value == "csv" || value == "json")) {
+            options.format = value;
+        } else if (key == "--output" && !value.empty()) {
+            options.output = value;
+        } else if (key == "--frames" && std::atoi(value.c_str()) > 0) {
+            options.frames = std::atoi(value.c_str());
+        } else if (key == "--warmup" && std::atoi(value.c_str()) >= 0) {
+            options.warmup = std::atoi(value.c_str());
+        } else if (key == "--backend" && (value == "all" || value == "opencl" || value == "native")) {
+            options.backend = value;
+        } else if (arg == "--quick") {
+            options.quick = true;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return false;
+        }
+    }
+    
+    // Trackers log to stdout, so results go to a file unless one is named
+    if (options.output.empty()) {
+        options.output = "tracker_bench." + options.format;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: tracker_bench [--format=csv|json] [--output=PATH] [--frames=N] [--warmup=N]"
+                  << " [--backend=all|opencl|native] [--quick]" << std::endl;
+        return -1;
+    }
+    
+    std::vector<int> template_sizes = {32, 48, 64, 80};
+    std::vector<int> search_margins = {50, 100, 150};
+    std::vector<int> channel_counts = {3, 1};
+    std::vector<std::string> opencl_variants = {"direct", "integral", "tiled", "tiled-generic", "fft"};
+    if (options.quick) {
+        template_sizes = {32, 64};
+        search_margins = {100};
+        opencl_variants = {"tiled"};
+    }
+    
+    cv::Mat texture = makeTexture();
+    std::vector<BenchResult> results;
+    
+    const char* backend_names[] = {"opencl", "native"};
+    for (int b = 0; b < 2; b++) {
+        std::string backend_name = backend_names[b];
+        if (options.backend != "all" && options.backend != backend_name) {
+            continue;
+        }
+        
+        std::unique_ptr<TrackerBackend> backend = createTrackerBackend(
+            b == 0 ? BackendType::OpenCL : BackendType::Native);
+        if (!backend) {
+            std::cerr << "Backend " << backend_name << " unavailable, skipping" << std::endl;
+            continue;
+        }
+        
+        std::vector<std::string> variants = b == 0 ? opencl_variants : std::vector<std::string>(1, "simd");
+        for (size_t v = 0; v < variants.size(); v++) {
+            for (size_t t = 0; t < template_sizes.size(); t++) {
+                for (size_t m = 0; m < search_margins.size(); m++) {
+                    for (size_t c = 0; c < channel_counts.size(); c++) {
+                        BenchConfig config;
+                        config.backend = backend_name;
+                        config.variant = variants[v];
+                        config.template_size = template_sizes[t];
+                        config.search_margin = search_margins[m];
+                        config.channels = channel_counts[c];
+                        if (config.search_margin * 2 <= config.template_size) {
+                            continue;
+                        }
+                        
+                        BenchResult result;
+                        if (runConfig(backend.get(), texture, config, options, result)) {
+                            results.push_back(result);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    std::ofstream out(options.output);
+    if (!out.is_open()) {
+        std::cerr << "Cannot write " << options.output << std::endl;
+        return -1;
+    }
+    if (options.format == "json") {
+        writeJson(out, results);
+    } else {
+        writeCsv(out, results);
+    }
+    
+    std::cerr << "Wrote " << results.size() << " results to " << options.output << std::endl;
+    return results.empty() ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+#include "camera_capture.h"
+#include "logger.h"
+
+namespace {
+
+// Frames handed to the display thread share their pixels. Decoding into a buffer that is
+// still referenced elsewhere would overwrite what is being displayed, so drop it and let
+// the decoder allocate a new one.
+void releaseIfShared(cv::Mat& image) {
+    if (image.u && image.u->refcount > 1) {
+        image.release();
+    }
+}
+
+// Search and template regions; 512x512 BGR covers any search margin we use
+const size_t kRegionSlotBytes = 512 * 512 * 3;
+const size_t kRegionSlotCount = 4;
+
+// Three frame slots, one frame queued for display and one being displayed
+const size_t kDisplaySlotCount = 6;
+
+// Three frame slots plus the one being retrieved into
+const size_t kBitstreamSlotCount = 4;
+
+} // namespace
+
+CameraCapture::CameraCapture() :
+    region_pool(new FramePool(kRegionSlotCount, kRegionSlotBytes)),
+    stop_thread(true),
+    display_scale(1),
+    last_sequence(0),
+    skipped_frames(0)
+{
+}
+
+CameraCapture::~CameraCapture() {
+    stop();
+}
+
+bool CameraCapture::open(int device, int width, int height, int fps, int scale) {
+    if (!cap.open(device, cv::CAP_V4L2)) {
+        return false;
+    }
+    cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M','J','P','G'));
+    cap.set(cv::CAP_PROP_FRAME_WIDTH, width);
+    cap.set(cv::CAP_PROP_FRAME_HEIGHT, height);
+    cap.set(cv::CAP_PROP_FPS, fps);
+    // Hand out the MJPEG bitstream instead of decoded BGR so decoding can be partial
+    display_scale = scale;
+    if (display_scale > 1 && !cap.set(cv::CAP_PROP_CONVERT_RGB, 0)) {
+        LOG_WARNING("Camera cannot deliver raw MJPEG, decoding full frames");
+        display_scale = 1;
+    }
+    // Keep the driver queue short so a slow consumer never receives stale frames
+    cap.set(cv::CAP_PROP_BUFFERSIZE, 1);
+    
+    // Bitstream sizes vary every frame; one byte per pixel is far above any MJPEG frame
+    size_t display_width = (width + display_scale - 1) / display_scale;
+    size_t display_height = (height + display_scale - 1) / display_scale;
+    bitstream_pool.reset(new FramePool(kBitstreamSlotCount, static_cast<size_t>(width) * height));
+    display_pool.reset(new FramePool(kDisplaySlotCount, display_width * display_height * 3));
+    return true;
+}
+
+void CameraCapture::start() {
+    if (capture_thread.joinable()) {
+        return;
+    }
+    stop_thread = false;
+    capture_thread = std::thread(&CameraCapture::captureThreadFunc, this);
+}
+
+void CameraCapture::stop() {
+    stop_thread = true;
+    if (capture_thread.joinable()) {
+        capture_thread.join();
+    }
+    cap.release();
+}
+
+const CapturedFrame* CameraCapture::waitForFrame(int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!slot.acquire()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return nullptr;
+        }
+        // Frames arrive every ~33 ms; a short sleep keeps the wake-up latency negligible
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    const CapturedFrame& frame = slot.readBuffer();
+    if (last_sequence != 0 && frame.sequence > last_sequence + 1) {
+        skipped_frames += frame.sequence - last_sequence - 1;
+    }
+    last_sequence = frame.sequence;
+    return &frame;
+}
+
+bool CameraCapture::decodeRegion(const CapturedFrame& frame, const cv::Rect& roi, cv::Mat& bgr) {
+    cv::Rect region = roi & cv::Rect(cv::Point(0, 0), frame.size);
+    if (region.empty()) {
+        return false;
+    }
+    if (!frame.image.empty()) {
+        bgr = frame.image(region);
+        return true;
+    }
+    region_pool->attach(bgr);
+    return region_decoder.decodeRegion(frame.jpeg.ptr<uint8_t>(), frame.jpeg.total(), region, bgr);
+}
+
+uint64_t CameraCapture::getSkippedCount() const {
+    return skipped_frames;
+}
+
+void CameraCapture::captureThreadFunc() {
+    uint64_t sequence = 0;
+    while (!stop_thread) {
+        // grab() returns as soon as the driver hands over a buffer; decode happens in retrieve()
+        if (!cap.grab()) {
+            LOG_EVERY_MS(LogLevel::Error, 1000, "Failed to grab frame!");
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            continue;
+        }
+        auto timestamp = std::chrono::steady_clock::now();
+
+        // The write buffer is never visible to the consumer, so decode straight into it
+        CapturedFrame& frame = slot.writeBuffer();
+        if (frame.display_scale == 1) {
+            frame.display.release();  // Alias of image
+        }
+        releaseIfShared(frame.display);
+        releaseIfShared(frame.image);
+        bitstream_pool->attach(frame.jpeg);
+        display_pool->attach(frame.display);
+        display_pool->attach(frame.image);
+        if (display_scale > 1) {
+            if (!cap.retrieve(frame.jpeg) || frame.jpeg.empty()) {
+                LOG_EVERY_MS(LogLevel::Error, 1000, "Failed to retrieve frame!");
+                continue;
+            }
+        }
+        if (display_scale > 1 && frame.jpeg.rows == 1) {
+            // Only the scaled display image is decoded here; the IDCT at 1/2 or 1/4
+            // touches a fraction of the coefficients of a full decode
+            const uint8_t* data = frame.jpeg.ptr<uint8_t>();
+            if (!display_decoder.readSize(data, frame.jpeg.total(), frame.size) ||
+                !display_decoder.decodeScaled(data, frame.jpeg.total(), display_scale, frame.display)) {
+                continue;
+            }
+            frame.image.release();
+            frame.display_scale = display_scale;
+        } else {
+            // Full decode mode, or a driver that decoded anyway
+            if (display_scale > 1) {
+                frame.image = frame.jpeg;
+                frame.jpeg.release();
+            } else if (!cap.retrieve(frame.image) || frame.image.empty()) {
+                LOG_EVERY_MS(LogLevel::Error, 1000, "Failed to decode frame!");
+                continue;
+            }
+            frame.display = frame.image;
+            frame.display_scale = 1;
+            frame.size = frame.image.size();
+        }
+        frame.sequence = ++sequence;
+        frame.timestamp = timestamp;
+        slot.publish();
+    }
+}
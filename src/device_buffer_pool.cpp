@@ -0,0 +1,70 @@
+#include "device_buffer_pool.h"
+#include "logger.h"
+#include <algorithm>
+
+DeviceBufferPool::DeviceBufferPool() : context(nullptr), allocation_count(0) {
+}
+
+DeviceBufferPool::~DeviceBufferPool() {
+    releaseAll();
+}
+
+void DeviceBufferPool::setContext(cl_context pool_context) {
+    releaseAll();
+    context = pool_context;
+}
+
+cl_mem DeviceBufferPool::acquire(int slot, size_t bytes, cl_mem_flags flags) {
+    if (slot >= static_cast<int>(entries.size())) {
+        Entry empty = {nullptr, 0, 0};
+        entries.resize(slot + 1, empty);
+    }
+    
+    Entry& entry = entries[slot];
+    if (entry.buffer && entry.capacity >= bytes && entry.flags == flags) {
+        return entry.buffer;
+    }
+    
+    // Grow: the old buffer stays alive until commands already using it complete
+    if (entry.buffer) {
+        clReleaseMemObject(entry.buffer);
+        entry.buffer = nullptr;
+    }
+    
+    size_t capacity = std::max(bytes, entry.capacity);
+    cl_int error;
+    entry.buffer = clCreateBuffer(context, flags, capacity, NULL, &error);
+    if (error != CL_SUCCESS) {
+        LOG_EVERY_MS(LogLevel::Error, 1000, "Failed to allocate pooled device buffer of %zu bytes (Error code: %d)",
+                     capacity, error);
+        entry.buffer = nullptr;
+        entry.capacity = 0;
+        return nullptr;
+    }
+    entry.capacity = capacity;
+    entry.flags = flags;
+    allocation_count++;
+    
+    return entry.buffer;
+}
+
+void DeviceBufferPool::releaseAll() {
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (entries[i].buffer) {
+            clReleaseMemObject(entries[i].buffer);
+        }
+    }
+    entries.clear();
+}
+
+size_t DeviceBufferPool::getAllocationCount() const {
+    return allocation_count;
+}
+
+size_t DeviceBufferPool::getCapacityBytes() const {
+    size_t total = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        total += entries[i].capacity;
+    }
+    return total;
+}
@@ -0,0 +1,115 @@
+#include "frame_pool.h"
+#include "logger.h"
+#include <cstdlib>
+
+FramePool::FramePool(size_t slot_count, size_t bytes) : slot_bytes(bytes), fallback_count(0) {
+    for (size_t i = 0; i < slot_count; i++) {
+        void* buffer = nullptr;
+        if (posix_memalign(&buffer, kAlignment, slot_bytes) != 0) {
+            LOG_ERROR("Cannot preallocate frame pool slot of %zu bytes", slot_bytes);
+            break;
+        }
+        slots.push_back(static_cast<unsigned char*>(buffer));
+    }
+    free_slots = slots;
+}
+
+FramePool::~FramePool() {
+    if (free_slots.size() != slots.size()) {
+        LOG_ERROR("Frame pool destroyed with %zu buffers still in use", slots.size() - free_slots.size());
+    }
+    for (size_t i = 0; i < slots.size(); i++) {
+        free(slots[i]);
+    }
+}
+
+void FramePool::attach(cv::Mat& mat) const {
+    mat.allocator = const_cast<FramePool*>(this);
+}
+
+size_t FramePool::getSlotBytes() const {
+    return slot_bytes;
+}
+
+size_t FramePool::getFreeCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return free_slots.size();
+}
+
+size_t FramePool::getFallbackCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return fallback_count;
+}
+
+cv::UMatData* FramePool::allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                                  cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usage_flags*/) const {
+    // Same layout rules as OpenCV's default allocator: honour explicit steps for user data
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data && step[i] != CV_AUTOSTEP) {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    cv::UMatData* u = new cv::UMatData(this);
+    u->size = total;
+    if (data) {
+        u->data = u->origdata = static_cast<uchar*>(data);
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+        return u;
+    }
+
+    unsigned char* buffer = nullptr;
+    if (total <= slot_bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!free_slots.empty()) {
+            buffer = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            fallback_count++;
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(mutex);
+        fallback_count++;
+    }
+
+    if (buffer) {
+        // userdata marks pooled buffers for deallocate()
+        u->userdata = buffer;
+    } else {
+        LOG_EVERY_MS(LogLevel::Warning, 1000, "Frame pool exhausted or too small for %zu bytes, using the heap", total);
+        buffer = static_cast<unsigned char*>(cv::fastMalloc(total));
+    }
+    u->data = u->origdata = buffer;
+    return u;
+}
+
+bool FramePool::allocate(cv::UMatData* /*data*/, cv::AccessFlag /*access_flags*/,
+                         cv::UMatUsageFlags /*usage_flags*/) const {
+    // Host memory only; there is nothing to map for UMat access
+    return false;
+}
+
+void FramePool::deallocate(cv::UMatData* u) const {
+    if (!u) {
+        return;
+    }
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+        if (u->userdata) {
+            std::lock_guard<std::mutex> lock(mutex);
+            free_slots.push_back(static_cast<unsigned char*>(u->userdata));
+        } else {
+            cv::fastFree(u->origdata);
+        }
+        u->origdata = nullptr;
+    }
+    delete u;
+}
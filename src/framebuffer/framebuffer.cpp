@@ -1,4 +1,7 @@
 #include "framebuffer.h"
+#include "pixel_pack.h"
+#include "thread_pool.h"
+#include "frame_pool.h"
 #include <iostream>
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -6,15 +9,31 @@
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <cstring>
+#include <utility>
 
 constexpr int MAX_QUEUE_SIZE = 1; // Max frames to buffer
 
+// Cortex-A55 cores that help the display thread convert frames; the A76 cores
+// are left to tracking and core 7 runs the display thread itself
+const std::vector<int> kConvertCores = {2, 3};
+
+// One frame queued, one being displayed and one scratch resize for 24bpp
+constexpr size_t kFramePoolSlots = 3;
+
 Framebuffer::Framebuffer() : 
     fbfd(-1), 
     fbp(nullptr), 
     vinfo(new fb_var_screeninfo), 
     finfo(new fb_fix_screeninfo), 
+    original_vinfo(new fb_var_screeninfo), 
     screen_size(0), 
+    double_buffered(false),
+    vinfo_changed(false),
+    vsync_supported(true),
+    back_buffer(1),
+    front_buffer(0),
+    convert_pool(new ThreadPool(static_cast<int>(kConvertCores.size()), kConvertCores)),
+    frame_pool(nullptr),
     stop_thread(false),
     width(0),
     height(0),
@@ -22,22 +41,33 @@ Framebuffer::Framebuffer() :
 {
     memset(vinfo, 0, sizeof(fb_var_screeninfo));
     memset(finfo, 0, sizeof(fb_fix_screeninfo));
+    memset(original_vinfo, 0, sizeof(fb_var_screeninfo));
 }
 
 Framebuffer::~Framebuffer() {
     stop();
     
+    // Queued frames may hold pooled buffers; return them before the pool goes away
+    std::queue<QueuedFrame>().swap(frame_queue);
+    
     if (fbp) {
         munmap(fbp, screen_size);
         fbp = nullptr;
     }
     if (fbfd != -1) {
+        // Leave the console on the first page with its original virtual size
+        if (vinfo_changed) {
+            ioctl(fbfd, FBIOPUT_VSCREENINFO, original_vinfo);
+        }
         close(fbfd);
         fbfd = -1;
     }
     
     delete vinfo;
     delete finfo;
+    delete original_vinfo;
+    delete convert_pool;
+    delete frame_pool;
 }
 
 bool Framebuffer::init() {
@@ -64,7 +94,10 @@ bool Framebuffer::init() {
     width = vinfo->xres;
     height = vinfo->yres;
     bits_per_pixel = vinfo->bits_per_pixel;
-    screen_size = width * height * bits_per_pixel / 8;
+    
+    // Two pages stacked vertically when the driver can pan, otherwise the visible page only
+    double_buffered = enableDoubleBuffering();
+    screen_size = (long)finfo->line_length * height * (double_buffered ? 2 : 1);
     
     fbp = (char*)mmap(0, screen_size, PROT_READ | PROT_WRITE, MAP_SHARED, fbfd, 0);
     
@@ -75,12 +108,127 @@ bool Framebuffer::init() {
         return false;
     }
 
+    // Frames are normally at most screen-sized; larger ones fall back to the heap
+    if (!frame_pool) {
+        frame_pool = new FramePool(kFramePoolSlots, (size_t)width * height * 3);
+    }
+
     std::cout << "Framebuffer initialized: " << width << "x" << height 
-              << " (" << bits_per_pixel << " bpp)" << std::endl;
+              << " (" << bits_per_pixel << " bpp, "
+              << (double_buffered ? "page flipping" : "single buffer") << ")" << std::endl;
     
     return true;
 }
 
+bool Framebuffer::enableDoubleBuffering() {
+    *original_vinfo = *vinfo;
+    
+    if (vinfo->yres_virtual < vinfo->yres * 2) {
+        fb_var_screeninfo request = *vinfo;
+        request.yres_virtual = vinfo->yres * 2;
+        request.xoffset = 0;
+        request.yoffset = 0;
+        if (ioctl(fbfd, FBIOPUT_VSCREENINFO, &request) == -1) {
+            return false;
+        }
+        vinfo_changed = true;
+        
+        // The driver may have adjusted the request; trust only what it reports back
+        if (ioctl(fbfd, FBIOGET_VSCREENINFO, vinfo) == -1 ||
+            ioctl(fbfd, FBIOGET_FSCREENINFO, finfo) == -1) {
+            return false;
+        }
+    }
+    
+    if (vinfo->yres_virtual < vinfo->yres * 2 ||
+        finfo->smem_len < finfo->line_length * vinfo->yres * 2 ||
+        vinfo->xres != (unsigned)width || vinfo->yres != (unsigned)height ||
+        vinfo->bits_per_pixel != (unsigned)bits_per_pixel) {
+        return false;
+    }
+    
+    // Drivers without panning support reject FBIOPAN_DISPLAY even for the first page
+    vinfo->xoffset = 0;
+    vinfo->yoffset = 0;
+    return ioctl(fbfd, FBIOPAN_DISPLAY, vinfo) != -1;
+}
+
+void Framebuffer::presentBuffer(int buffer) {
+    vinfo->yoffset = buffer * height;
+    if (ioctl(fbfd, FBIOPAN_DISPLAY, vinfo) == -1) {
+        // The previous page is still on screen; draw into it from now on so the
+        // display keeps updating even if that page was page 1
+        std::cerr << "FBIOPAN_DISPLAY failed, falling back to single buffering on page "
+                  << front_buffer << std::endl;
+        double_buffered = false;
+        return;
+    }
+    
+    // Wait for the flip to reach the screen before the old front page is drawn over
+    if (vsync_supported) {
+        __u32 crtc = 0;
+        if (ioctl(fbfd, FBIO_WAITFORVSYNC, &crtc) == -1) {
+            vsync_supported = false;
+        }
+    }
+    front_buffer = buffer;
+    back_buffer = 1 - buffer;
+}
+
+void Framebuffer::drawOverlay(const Overlay& overlay, const cv::Size& frame_size, cv::Mat& page) const {
+    cv::Size canvas = overlay.getCanvas().area() > 0 ? overlay.getCanvas() : frame_size;
+    if (canvas.area() <= 0) {
+        return;
+    }
+    const double scale_x = static_cast<double>(page.cols) / canvas.width;
+    const double scale_y = static_cast<double>(page.rows) / canvas.height;
+    
+    const std::vector<OverlayItem>& items = overlay.getItems();
+    for (size_t i = 0; i < items.size(); i++) {
+        const OverlayItem& item = items[i];
+        cv::Point p0(cvRound(item.p0.x * scale_x), cvRound(item.p0.y * scale_y));
+        cv::Point p1(cvRound(item.p1.x * scale_x), cvRound(item.p1.y * scale_y));
+        cv::Scalar color = panelColor(item.color);
+        
+        // Anti-aliased drawing would blend packed RGB565 values, so stick to LINE_8
+        switch (item.type) {
+            case OverlayItem::Line:
+                cv::line(page, p0, p1, color, item.thickness, cv::LINE_8);
+                break;
+            case OverlayItem::Circle:
+                cv::circle(page, p0, item.radius, color, item.thickness, cv::LINE_8);
+                break;
+            case OverlayItem::Rectangle:
+                cv::rectangle(page, p0, p1, color, item.thickness, cv::LINE_8);
+                break;
+            case OverlayItem::Text:
+                cv::putText(page, item.text, p0, cv::FONT_HERSHEY_SIMPLEX, item.font_scale,
+                            color, item.thickness, cv::LINE_8);
+                break;
+        }
+    }
+}
+
+cv::Scalar Framebuffer::panelColor(const cv::Scalar& bgr) const {
+    int b = cv::saturate_cast<uchar>(bgr[0]);
+    int g = cv::saturate_cast<uchar>(bgr[1]);
+    int r = cv::saturate_cast<uchar>(bgr[2]);
+    switch (bits_per_pixel) {
+        case 32:
+            return cv::Scalar(b, g, r, 255);
+        case 24:
+            return cv::Scalar(r, g, b);
+        case 16:
+            return cv::Scalar(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+        default:
+            return cv::Scalar((b * 29 + g * 150 + r * 77 + 128) >> 8);
+    }
+}
+
+bool Framebuffer::isDoubleBuffered() const {
+    return double_buffered;
+}
+
 void Framebuffer::startDisplayThread() {
     stop_thread = false;
     display_thread = std::thread(&Framebuffer::displayThreadFunc, this);
@@ -93,7 +241,32 @@ void Framebuffer::pushFrame(const cv::Mat& frame) {
     if (frame_queue.size() >= MAX_QUEUE_SIZE) {
         frame_queue.pop();
     }
-    frame_queue.push(frame.clone()); // Clone to ensure data ownership
+    QueuedFrame queued;
+    // Copy to ensure data ownership, into a pooled buffer once init() has run
+    if (frame_pool) {
+        frame_pool->attach(queued.image);
+    }
+    frame.copyTo(queued.image);
+    frame_queue.push(std::move(queued));
+    lock.unlock();
+    queue_cond.notify_one();
+}
+
+void Framebuffer::pushFrame(cv::Mat&& frame) {
+    pushFrame(std::move(frame), Overlay());
+}
+
+void Framebuffer::pushFrame(cv::Mat&& frame, Overlay&& overlay) {
+    QueuedFrame queued;
+    queued.image = std::move(frame);
+    queued.overlay = std::move(overlay);
+    
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    // Drop oldest frame if queue is full
+    if (frame_queue.size() >= MAX_QUEUE_SIZE) {
+        frame_queue.pop();
+    }
+    frame_queue.push(std::move(queued));
     lock.unlock();
     queue_cond.notify_one();
 }
@@ -123,19 +296,28 @@ int Framebuffer::getBpp() const {
 
 void Framebuffer::displayThreadFunc() {
     const int fb_line_length = finfo->line_length;
-    const int fb_xoffset = vinfo->xoffset;
-    const int fb_yoffset = vinfo->yoffset;
+    const int fb_xoffset = double_buffered ? 0 : vinfo->xoffset;
+    const int visible_yoffset = double_buffered ? 0 : vinfo->yoffset;
     
-    // Create a Mat that directly maps to framebuffer memory for supported formats
-    cv::Mat fb_mat;
-    if (bits_per_pixel == 32) {
-        fb_mat = cv::Mat(height, width, CV_8UC4, fbp, fb_line_length);
-    } else if (bits_per_pixel == 24) {
-        fb_mat = cv::Mat(height, width, CV_8UC3, fbp, fb_line_length);
+    // Mats that directly map each framebuffer page; 16bpp pages are single 16-bit
+    // channels so overlay colours can be written as packed RGB565 values
+    cv::Mat fb_pages[2];
+    for (int page = 0; page < (double_buffered ? 2 : 1); page++) {
+        char* page_base = fbp + ((long)page * height + visible_yoffset) * fb_line_length;
+        if (bits_per_pixel == 32) {
+            fb_pages[page] = cv::Mat(height, width, CV_8UC4, page_base + fb_xoffset * 4, fb_line_length);
+        } else if (bits_per_pixel == 24) {
+            fb_pages[page] = cv::Mat(height, width, CV_8UC3, page_base + fb_xoffset * 3, fb_line_length);
+        } else if (bits_per_pixel == 16) {
+            fb_pages[page] = cv::Mat(height, width, CV_16UC1, page_base + fb_xoffset * 2, fb_line_length);
+        } else if (bits_per_pixel == 8) {
+            fb_pages[page] = cv::Mat(height, width, CV_8UC1, page_base + fb_xoffset, fb_line_length);
+        }
     }
     
     while (true) {
         cv::Mat frame;
+        Overlay overlay;
         {
             std::unique_lock<std::mutex> lock(queue_mutex);
             queue_cond.wait(lock, [this] { 
@@ -144,15 +326,29 @@ void Framebuffer::displayThreadFunc() {
             
             if (stop_thread) break;
             
-            frame = frame_queue.front();
+            frame = frame_queue.front().image;
+            overlay = std::move(frame_queue.front().overlay);
             frame_queue.pop();
         }
         
         if (!fbp || frame.empty()) continue;
+        
+        // With page flipping everything is drawn into the hidden page, otherwise into the visible one
+        // Single buffered: the page on screen (0 unless a page flip failed after page 1 was shown)
+        const int page = double_buffered ? back_buffer : front_buffer;
+        const int fb_yoffset = page * height + visible_yoffset;
+        cv::Mat& fb_mat = fb_pages[page];
 
-        // Use OpenCV's optimized path for 32bpp and 24bpp
-        if ((bits_per_pixel == 32 || bits_per_pixel == 24) && !fb_mat.empty()) {
+        // Resize, convert and pack in one pass straight into framebuffer memory
+        if (frame.channels() == 1) {
+            cv::cvtColor(frame, frame, cv::COLOR_GRAY2BGR);
+        }
+        if (bits_per_pixel == 32) {
+            resizeAndPack(frame, PixelFormat::Bgra8888, fb_mat.data, fb_mat.step, width, height, convert_pool);
+        }
+        else if (bits_per_pixel == 24 && !fb_mat.empty()) {
             cv::Mat processed_frame;
+            frame_pool->attach(processed_frame);
             
             // Resize if needed
             if (frame.size() != fb_mat.size()) {
@@ -161,78 +357,15 @@ void Framebuffer::displayThreadFunc() {
                 processed_frame = frame;
             }
             
-            // Convert color space
-            if (bits_per_pixel == 32) {
-                // Convert BGR to BGRA (adding alpha channel)
-                cv::cvtColor(processed_frame, processed_frame, cv::COLOR_BGR2BGRA);
-            } else if (bits_per_pixel == 24) {
-                // Convert BGR to RGB for 24bpp
-                cv::cvtColor(processed_frame, processed_frame, cv::COLOR_BGR2RGB);
-            }
-            
-            // Copy to framebuffer using OpenCV's optimized memcpy
-            processed_frame.copyTo(fb_mat);
+            // Convert BGR to RGB straight into framebuffer memory; fb_mat already has the
+            // destination size and type, so cvtColor writes through it instead of reallocating
+            cv::cvtColor(processed_frame, fb_mat, cv::COLOR_BGR2RGB);
         }
         else if (bits_per_pixel == 16) {
-            // Optimized manual implementation for 16bpp (RGB565)
-            cv::Mat rgb_frame;
-            
-            // Resize and convert to RGB
-            if (frame.cols != width || frame.rows != height) {
-                cv::resize(frame, rgb_frame, cv::Size(width, height));
-                cv::cvtColor(rgb_frame, rgb_frame, cv::COLOR_BGR2RGB);
-            } else {
-                cv::cvtColor(frame, rgb_frame, cv::COLOR_BGR2RGB);
-            }
-            
-            const uchar* frame_data = rgb_frame.data;
-            const int frame_step = rgb_frame.step;
-            
-            // Optimized 16bpp copy
-            for (int y = 0; y < height; y++) {
-                const uchar* src_row = frame_data + y * frame_step;
-                char* dst_row = fbp + (y + fb_yoffset) * fb_line_length;
-                
-                for (int x = 0; x < width; x++) {
-                    const uchar* src_pixel = src_row + x * 3;
-                    unsigned short* dst_pixel = 
-                        reinterpret_cast<unsigned short*>(dst_row + (x + fb_xoffset) * 2);
-                    
-                    // Convert RGB888 to RGB565
-                    unsigned short b = src_pixel[2] >> 3;
-                    unsigned short g = src_pixel[1] >> 2;
-                    unsigned short r = src_pixel[0] >> 3;
-                    *dst_pixel = (r << 11) | (g << 5) | b;
-                }
-            }
+            resizeAndPack(frame, PixelFormat::Rgb565, fb_mat.data, fb_mat.step, width, height, convert_pool);
         }
         else if (bits_per_pixel == 8) {
-            // Handle 8bpp grayscale
-            cv::Mat gray_frame;
-            
-            if (frame.cols != width || frame.rows != height) {
-                cv::resize(frame, gray_frame, cv::Size(width, height));
-            } else {
-                gray_frame = frame;
-            }
-            
-            // Convert to grayscale if not already
-            if (gray_frame.channels() > 1) {
-                cv::cvtColor(gray_frame, gray_frame, cv::COLOR_BGR2GRAY);
-            }
-            
-            const uchar* frame_data = gray_frame.data;
-            const int frame_step = gray_frame.step;
-            
-            // Direct copy for 8bpp
-            for (int y = 0; y < height; y++) {
-                const uchar* src_row = frame_data + y * frame_step;
-                char* dst_row = fbp + (y + fb_yoffset) * fb_line_length;
-                
-                for (int x = 0; x < width; x++) {
-                    dst_row[x + fb_xoffset] = src_row[x];
-                }
-            }
+            resizeAndPack(frame, PixelFormat::Gray8, fb_mat.data, fb_mat.step, width, height, convert_pool);
         }
         else {
             // Fallback for unsupported formats - convert to 32bpp and use OpenCV
@@ -263,5 +396,14 @@ void Framebuffer::displayThreadFunc() {
                 }
             }
         }
+        
+        // Annotations go on top of the scaled frame, at panel resolution
+        if (!fb_mat.empty()) {
+            drawOverlay(overlay, frame.size(), fb_mat);
+        }
+        
+        if (double_buffered) {
+            presentBuffer(page);
+        }
     }
 }
\ No newline at end of file
@@ -8,10 +8,13 @@
 #include <condition_variable>
 #include <atomic>
 #include <cstdint>
+#include "overlay.h"
 
 // Forward declarations for Linux framebuffer structures
 struct fb_var_screeninfo;
 struct fb_fix_screeninfo;
+class ThreadPool;
+class FramePool;
 
 class Framebuffer {
 public:
@@ -21,8 +24,16 @@ public:
     bool init();
     void startDisplayThread();
     void pushFrame(const cv::Mat& frame);
+    // Takes over the frame's pixels instead of cloning them
+    void pushFrame(cv::Mat&& frame);
+    // Shows frame with overlay drawn on top by the display thread. The frame is shared,
+    // not copied: the caller must not write to its pixels afterwards.
+    void pushFrame(cv::Mat&& frame, Overlay&& overlay);
     void stop();
 
+    // True when frames are rendered off-screen and flipped in with FBIOPAN_DISPLAY
+    bool isDoubleBuffered() const;
+
     // Get framebuffer dimensions
     int getWidth() const;
     int getHeight() const;
@@ -30,16 +41,38 @@ public:
 
 private:
     void displayThreadFunc();
+    bool enableDoubleBuffering();
+    void presentBuffer(int buffer);
+    void drawOverlay(const Overlay& overlay, const cv::Size& frame_size, cv::Mat& page) const;
+    cv::Scalar panelColor(const cv::Scalar& bgr) const;
 
     int fbfd;
     char* fbp;
     fb_var_screeninfo* vinfo;
     fb_fix_screeninfo* finfo;
+    fb_var_screeninfo* original_vinfo;  // Restored on shutdown if double buffering changed it
     long int screen_size;
     
+    // Page flipping: buffer 0 at yoffset 0, buffer 1 at yoffset height
+    bool double_buffered;
+    bool vinfo_changed;
+    bool vsync_supported;
+    int back_buffer;
+    int front_buffer;       // Page currently scanned out
+    
+    // Splits resize + pixel packing into row bands
+    ThreadPool* convert_pool;
+    
+    // Screen-sized buffers for cloned frames and 24bpp resizes, created by init()
+    FramePool* frame_pool;
+    
     // Threading components
     std::thread display_thread;
-    std::queue<cv::Mat> frame_queue;
+    struct QueuedFrame {
+        cv::Mat image;
+        Overlay overlay;
+    };
+    std::queue<QueuedFrame> frame_queue;
     std::mutex queue_mutex;
     std::condition_variable queue_cond;
     std::atomic<bool> stop_thread;
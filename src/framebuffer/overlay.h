@@ -0,0 +1,73 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+// One annotation primitive. Positions are in overlay canvas coordinates; radius,
+// thickness and font scale are in screen pixels so annotations stay crisp at any
+// frame-to-panel scale.
+struct OverlayItem {
+    enum Type { Line, Circle, Rectangle, Text };
+
+    Type type;
+    cv::Point p0;           // Line start, circle centre, rectangle corner, text origin
+    cv::Point p1;           // Line end, opposite rectangle corner
+    int radius;
+    cv::Scalar color;       // BGR
+    int thickness;          // -1 fills circles and rectangles
+    double font_scale;
+    std::string text;
+};
+
+// Display list handed to Framebuffer together with a frame. The display thread draws
+// it straight into the framebuffer after scaling the frame, so the producer never
+// copies or modifies the frame itself.
+class Overlay {
+public:
+    Overlay() {}
+    // canvas is the coordinate space of the items; empty means the frame's size
+    explicit Overlay(const cv::Size& canvas_size) : canvas(canvas_size) {}
+
+    void line(const cv::Point& from, const cv::Point& to, const cv::Scalar& color, int thickness = 1) {
+        add(OverlayItem::Line, from, to, 0, color, thickness);
+    }
+
+    void circle(const cv::Point& center, int radius, const cv::Scalar& color, int thickness = 1) {
+        add(OverlayItem::Circle, center, center, radius, color, thickness);
+    }
+
+    void rectangle(const cv::Rect& rect, const cv::Scalar& color, int thickness = 1) {
+        add(OverlayItem::Rectangle, rect.tl(), rect.br(), 0, color, thickness);
+    }
+
+    void text(const std::string& str, const cv::Point& origin, double font_scale,
+              const cv::Scalar& color, int thickness = 1) {
+        add(OverlayItem::Text, origin, origin, 0, color, thickness);
+        items.back().font_scale = font_scale;
+        items.back().text = str;
+    }
+
+    const std::vector<OverlayItem>& getItems() const { return items; }
+    const cv::Size& getCanvas() const { return canvas; }
+
+private:
+    void add(OverlayItem::Type type, const cv::Point& p0, const cv::Point& p1, int radius,
+             const cv::Scalar& color, int thickness) {
+        OverlayItem item;
+        item.type = type;
+        item.p0 = p0;
+        item.p1 = p1;
+        item.radius = radius;
+        item.color = color;
+        item.thickness = thickness;
+        item.font_scale = 0.0;
+        items.push_back(item);
+    }
+
+    cv::Size canvas;
+    std::vector<OverlayItem> items;
+};
+
+#endif // OVERLAY_H
@@ -0,0 +1,290 @@
+#include "pixel_pack.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <vector>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Source sample and 8-bit weight of its right/lower neighbour for one output column or
+// row, using the pixel-centre convention of cv::resize(INTER_LINEAR)
+struct Tap {
+    int index;
+    int next;
+    int weight;
+};
+
+void computeTaps(int src_size, int dst_size, std::vector<Tap>& taps) {
+    taps.resize(dst_size);
+    double scale = static_cast<double>(src_size) / dst_size;
+    for (int i = 0; i < dst_size; i++) {
+        double position = std::max(0.0, (i + 0.5) * scale - 0.5);
+        int index = std::min(static_cast<int>(position), src_size - 1);
+        int weight = static_cast<int>((position - index) * 256.0 + 0.5);
+        if (weight >= 256) {
+            index = std::min(index + 1, src_size - 1);
+            weight = 0;
+        }
+        taps[i].index = index;
+        taps[i].next = std::min(index + 1, src_size - 1);
+        taps[i].weight = weight;
+    }
+}
+
+// out = (a * (256 - weight) + b * weight) / 256, rounded; weight in [1, 255]
+void blendRows(const unsigned char* a, const unsigned char* b, int weight, unsigned char* out, int count) {
+    int i = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint8x8_t weight_a = vdup_n_u8(static_cast<uint8_t>(256 - weight));
+    uint8x8_t weight_b = vdup_n_u8(static_cast<uint8_t>(weight));
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t va = vld1q_u8(a + i);
+        uint8x16_t vb = vld1q_u8(b + i);
+        uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(va), weight_a), vget_low_u8(vb), weight_b);
+        uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(va), weight_a), vget_high_u8(vb), weight_b);
+        vst1q_u8(out + i, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weight_a = _mm_set1_epi16(static_cast<short>(256 - weight));
+    const __m128i weight_b = _mm_set1_epi16(static_cast<short>(weight));
+    const __m128i half = _mm_set1_epi16(128);
+    for (; i + 16 <= count; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), weight_a),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), weight_b));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), weight_a),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), weight_b));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, half), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, half), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = static_cast<unsigned char>((a[i] * (256 - weight) + b[i] * weight + 128) >> 8);
+    }
+}
+
+// Splits a BGR row into planes; used when no horizontal resampling is needed
+void deinterleaveRow(const unsigned char* src, int width,
+                     unsigned char* b, unsigned char* g, unsigned char* r) {
+    int x = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x3_t bgr = vld3q_u8(src + x * 3);
+        vst1q_u8(b + x, bgr.val[0]);
+        vst1q_u8(g + x, bgr.val[1]);
+        vst1q_u8(r + x, bgr.val[2]);
+    }
+#endif
+    for (; x < width; x++) {
+        b[x] = src[x * 3];
+        g[x] = src[x * 3 + 1];
+        r[x] = src[x * 3 + 2];
+    }
+}
+
+// Horizontal bilinear resampling of a BGR row into planes
+void resampleRow(const unsigned char* src, const Tap* taps, int width,
+                 unsigned char* b, unsigned char* g, unsigned char* r) {
+    for (int x = 0; x < width; x++) {
+        const unsigned char* p0 = src + taps[x].index * 3;
+        const unsigned char* p1 = src + taps[x].next * 3;
+        int w1 = taps[x].weight;
+        int w0 = 256 - w1;
+        b[x] = static_cast<unsigned char>((p0[0] * w0 + p1[0] * w1 + 128) >> 8);
+        g[x] = static_cast<unsigned char>((p0[1] * w0 + p1[1] * w1 + 128) >> 8);
+        r[x] = static_cast<unsigned char>((p0[2] * w0 + p1[2] * w1 + 128) >> 8);
+    }
+}
+
+// RGB565 little-endian: low byte gggbbbbb, high byte rrrrrggg
+void packRgb565(const unsigned char* b, const unsigned char* g, const unsigned char* r,
+                int width, unsigned char* dst) {
+    int x = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t vb = vld1q_u8(b + x);
+        uint8x16_t vg = vld1q_u8(g + x);
+        uint8x16_t vr = vld1q_u8(r + x);
+        uint8x16x2_t out;
+        out.val[0] = vorrq_u8(vandq_u8(vshlq_n_u8(vg, 3), vdupq_n_u8(0xE0)), vshrq_n_u8(vb, 3));
+        out.val[1] = vorrq_u8(vandq_u8(vr, vdupq_n_u8(0xF8)), vshrq_n_u8(vg, 5));
+        vst2q_u8(dst + x * 2, out);
+    }
+#elif defined(__SSE2__)
+    // SSE2 has no 8-bit shifts; shift 16-bit lanes and mask off the bits from the neighbour
+    const __m128i mask_e0 = _mm_set1_epi8(static_cast<char>(0xE0));
+    const __m128i mask_f8 = _mm_set1_epi8(static_cast<char>(0xF8));
+    const __m128i mask_1f = _mm_set1_epi8(0x1F);
+    const __m128i mask_07 = _mm_set1_epi8(0x07);
+    for (; x + 16 <= width; x += 16) {
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+        __m128i vg = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g + x));
+        __m128i vr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + x));
+        __m128i lo = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(vg, 3), mask_e0),
+                                  _mm_and_si128(_mm_srli_epi16(vb, 3), mask_1f));
+        __m128i hi = _mm_or_si128(_mm_and_si128(vr, mask_f8),
+                                  _mm_and_si128(_mm_srli_epi16(vg, 5), mask_07));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 2), _mm_unpacklo_epi8(lo, hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 2 + 16), _mm_unpackhi_epi8(lo, hi));
+    }
+#endif
+    for (; x < width; x++) {
+        dst[x * 2] = static_cast<unsigned char>(((g[x] << 3) & 0xE0) | (b[x] >> 3));
+        dst[x * 2 + 1] = static_cast<unsigned char>((r[x] & 0xF8) | (g[x] >> 5));
+    }
+}
+
+void packBgra(const unsigned char* b, const unsigned char* g, const unsigned char* r,
+              int width, unsigned char* dst) {
+    int x = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t out;
+        out.val[0] = vld1q_u8(b + x);
+        out.val[1] = vld1q_u8(g + x);
+        out.val[2] = vld1q_u8(r + x);
+        out.val[3] = vdupq_n_u8(255);
+        vst4q_u8(dst + x * 4, out);
+    }
+#elif defined(__SSE2__)
+    const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xFF));
+    for (; x + 16 <= width; x += 16) {
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+        __m128i vg = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g + x));
+        __m128i vr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + x));
+        __m128i bg_lo = _mm_unpacklo_epi8(vb, vg);
+        __m128i bg_hi = _mm_unpackhi_epi8(vb, vg);
+        __m128i ra_lo = _mm_unpacklo_epi8(vr, alpha);
+        __m128i ra_hi = _mm_unpackhi_epi8(vr, alpha);
+        __m128i* out = reinterpret_cast<__m128i*>(dst + x * 4);
+        _mm_storeu_si128(out, _mm_unpacklo_epi16(bg_lo, ra_lo));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(bg_lo, ra_lo));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(bg_hi, ra_hi));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(bg_hi, ra_hi));
+    }
+#endif
+    for (; x < width; x++) {
+        dst[x * 4] = b[x];
+        dst[x * 4 + 1] = g[x];
+        dst[x * 4 + 2] = r[x];
+        dst[x * 4 + 3] = 255;
+    }
+}
+
+// BT.601 luma with 8-bit weights summing to 256, as in cv::COLOR_BGR2GRAY
+const int kGrayB = 29;
+const int kGrayG = 150;
+const int kGrayR = 77;
+
+void packGray(const unsigned char* b, const unsigned char* g, const unsigned char* r,
+              int width, unsigned char* dst) {
+    int x = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x8_t weight_b = vdup_n_u8(kGrayB);
+    const uint8x8_t weight_g = vdup_n_u8(kGrayG);
+    const uint8x8_t weight_r = vdup_n_u8(kGrayR);
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t vb = vld1q_u8(b + x);
+        uint8x16_t vg = vld1q_u8(g + x);
+        uint8x16_t vr = vld1q_u8(r + x);
+        uint16x8_t lo = vmull_u8(vget_low_u8(vb), weight_b);
+        lo = vmlal_u8(lo, vget_low_u8(vg), weight_g);
+        lo = vmlal_u8(lo, vget_low_u8(vr), weight_r);
+        uint16x8_t hi = vmull_u8(vget_high_u8(vb), weight_b);
+        hi = vmlal_u8(hi, vget_high_u8(vg), weight_g);
+        hi = vmlal_u8(hi, vget_high_u8(vr), weight_r);
+        vst1q_u8(dst + x, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weight_b = _mm_set1_epi16(kGrayB);
+    const __m128i weight_g = _mm_set1_epi16(kGrayG);
+    const __m128i weight_r = _mm_set1_epi16(kGrayR);
+    const __m128i half = _mm_set1_epi16(128);
+    for (; x + 16 <= width; x += 16) {
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+        __m128i vg = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g + x));
+        __m128i vr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + x));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), weight_b),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(vg, zero), weight_g));
+        lo = _mm_add_epi16(lo, _mm_mullo_epi16(_mm_unpacklo_epi8(vr, zero), weight_r));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), weight_b),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(vg, zero), weight_g));
+        hi = _mm_add_epi16(hi, _mm_mullo_epi16(_mm_unpackhi_epi8(vr, zero), weight_r));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, half), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, half), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; x < width; x++) {
+        dst[x] = static_cast<unsigned char>((b[x] * kGrayB + g[x] * kGrayG + r[x] * kGrayR + 128) >> 8);
+    }
+}
+
+} // namespace
+
+void resizeAndPack(const cv::Mat& bgr, PixelFormat format,
+                   unsigned char* dst, size_t dst_step, int dst_width, int dst_height,
+                   ThreadPool* pool) {
+    CV_Assert(bgr.type() == CV_8UC3);
+    if (bgr.empty() || dst_width <= 0 || dst_height <= 0) {
+        return;
+    }
+
+    std::vector<Tap> column_taps;
+    std::vector<Tap> row_taps;
+    computeTaps(bgr.cols, dst_width, column_taps);
+    computeTaps(bgr.rows, dst_height, row_taps);
+    const bool same_width = bgr.cols == dst_width;
+
+    auto band = [&](int row_begin, int row_end) {
+        // Per-band scratch: one vertically blended source row and three output planes
+        std::vector<unsigned char> blended(bgr.cols * 3);
+        std::vector<unsigned char> planes(dst_width * 3);
+        unsigned char* b = planes.data();
+        unsigned char* g = b + dst_width;
+        unsigned char* r = g + dst_width;
+
+        for (int y = row_begin; y < row_end; y++) {
+            const Tap& tap = row_taps[y];
+            const unsigned char* src_row = bgr.ptr<unsigned char>(tap.index);
+            if (tap.weight != 0) {
+                blendRows(src_row, bgr.ptr<unsigned char>(tap.next), tap.weight, blended.data(), bgr.cols * 3);
+                src_row = blended.data();
+            }
+
+            if (same_width) {
+                deinterleaveRow(src_row, dst_width, b, g, r);
+            } else {
+                resampleRow(src_row, column_taps.data(), dst_width, b, g, r);
+            }
+
+            unsigned char* dst_row = dst + y * dst_step;
+            switch (format) {
+                case PixelFormat::Rgb565:
+                    packRgb565(b, g, r, dst_width, dst_row);
+                    break;
+                case PixelFormat::Bgra8888:
+                    packBgra(b, g, r, dst_width, dst_row);
+                    break;
+                case PixelFormat::Gray8:
+                    packGray(b, g, r, dst_width, dst_row);
+                    break;
+            }
+        }
+    };
+
+    if (pool) {
+        pool->parallelFor(0, dst_height, band);
+    } else {
+        band(0, dst_height);
+    }
+}
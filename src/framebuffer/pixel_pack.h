@@ -0,0 +1,24 @@
+#ifndef PIXEL_PACK_H
+#define PIXEL_PACK_H
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+
+class ThreadPool;
+
+// Framebuffer pixel layouts produced from BGR frames
+enum class PixelFormat {
+    Rgb565,    // 16 bpp, red in the top bits, little-endian
+    Bgra8888,  // 32 bpp, alpha 255
+    Gray8      // 8 bpp luma
+};
+
+// Bilinearly resizes a CV_8UC3 BGR image to dst_width x dst_height and writes it to dst
+// in the given format. Resize, colour conversion and packing run row by row through
+// small per-thread buffers, so the source is read once and the destination written
+// once. Output rows are split into one band per thread of pool when it is not null.
+void resizeAndPack(const cv::Mat& bgr, PixelFormat format,
+                   unsigned char* dst, size_t dst_step, int dst_width, int dst_height,
+                   ThreadPool* pool);
+
+#endif // PIXEL_PACK_H
@@ -0,0 +1,181 @@
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+// Interval at which the background thread looks for new records
+const int kDrainIntervalMs = 10;
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* levelTag(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "D";
+        case LogLevel::Info: return "I";
+        case LogLevel::Warning: return "W";
+        case LogLevel::Error: return "E";
+        default: return "?";
+    }
+}
+
+// Start of the process as seen by the logger, for relative timestamps
+const int64_t kStartNs = nowNs();
+
+} // namespace
+
+std::atomic<int> Logger::min_level(static_cast<int>(LogLevel::Info));
+
+Logger& Logger::instance() {
+    // Never destroyed: threads that are still running at exit may keep logging
+    static Logger* logger = new Logger();
+    return *logger;
+}
+
+Logger::Logger() :
+    output(stdout),
+    error_output(stderr),
+    dropped(0)
+{
+    drain_thread = std::thread(&Logger::drainLoop, this);
+    drain_thread.detach();
+    std::atexit(&Logger::flushAtExit);
+}
+
+void Logger::flushAtExit() {
+    Logger& logger = instance();
+    logger.drain();
+    
+    uint64_t lost = logger.dropped.load();
+    if (lost > 0) {
+        std::lock_guard<std::mutex> lock(logger.drain_mutex);
+        std::fprintf(logger.error_output, "Logger dropped %llu messages\n", static_cast<unsigned long long>(lost));
+        std::fflush(logger.error_output);
+    }
+}
+
+void Logger::setLevel(LogLevel level) {
+    min_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::getLevel() {
+    return static_cast<LogLevel>(min_level.load(std::memory_order_relaxed));
+}
+
+bool Logger::parseLevel(const std::string& name, LogLevel& level) {
+    const char* names[] = {"debug", "info", "warning", "error", "off"};
+    for (int i = 0; i < 5; i++) {
+        if (name == names[i]) {
+            level = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Logger::rateLimit(std::atomic<int64_t>& last_ns, int64_t interval_ms) {
+    int64_t now = nowNs();
+    int64_t last = last_ns.load(std::memory_order_relaxed);
+    if (now - last < interval_ms * 1000000) {
+        return false;
+    }
+    // Only one of several racing threads wins the slot
+    return last_ns.compare_exchange_strong(last, now, std::memory_order_relaxed);
+}
+
+Logger::Ring* Logger::threadRing() {
+    static thread_local Ring* ring = nullptr;
+    if (ring == nullptr) {
+        std::unique_ptr<Ring> created(new Ring());
+        created->head.store(0);
+        created->tail.store(0);
+        
+        // Rings outlive their threads so late records are still written
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        created->thread_index = static_cast<uint32_t>(rings.size());
+        ring = created.get();
+        rings.push_back(std::move(created));
+    }
+    return ring;
+}
+
+void Logger::write(LogLevel level, const char* format, ...) {
+    Ring* ring = threadRing();
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= kRingCapacity) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    
+    Record& record = ring->records[head % kRingCapacity];
+    record.timestamp_ns = nowNs();
+    record.level = level;
+    record.thread_index = ring->thread_index;
+    
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(record.text, kMessageSize, format, args);
+    va_end(args);
+    
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void Logger::flush() {
+    drain();
+}
+
+void Logger::setOutput(FILE* file, FILE* error_file) {
+    std::lock_guard<std::mutex> lock(drain_mutex);
+    output = file;
+    error_output = error_file;
+}
+
+uint64_t Logger::getDroppedCount() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void Logger::drainLoop() {
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(kDrainIntervalMs));
+        drain();
+    }
+}
+
+void Logger::drain() {
+    std::lock_guard<std::mutex> drain_lock(drain_mutex);
+    batch.clear();
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (size_t i = 0; i < rings.size(); i++) {
+            Ring& ring = *rings[i];
+            size_t tail = ring.tail.load(std::memory_order_relaxed);
+            size_t head = ring.head.load(std::memory_order_acquire);
+            for (; tail != head; tail++) {
+                batch.push_back(ring.records[tail % kRingCapacity]);
+            }
+            ring.tail.store(tail, std::memory_order_release);
+        }
+    }
+    if (batch.empty()) {
+        return;
+    }
+    
+    // Each ring is already ordered; merge the threads by time
+    std::stable_sort(batch.begin(), batch.end(), [](const Record& a, const Record& b) {
+        return a.timestamp_ns < b.timestamp_ns;
+    });
+    for (size_t i = 0; i < batch.size(); i++) {
+        const Record& record = batch[i];
+        FILE* file = record.level >= LogLevel::Warning ? error_output : output;
+        std::fprintf(file, "[%10.6f] %s T%u %s\n", (record.timestamp_ns - kStartNs) * 1e-9,
+                     levelTag(record.level), record.thread_index, record.text);
+    }
+    std::fflush(output);
+    std::fflush(error_output);
+}
@@ -1,4 +1,8 @@
-#include "tracker.h"
+#include "tracker_backend.h"
+#include "replay.h"
+#include "logger.h"
+#include "camera_capture.h"
+#include "motion_model.h"
 #include <opencv2/opencv.hpp>
 #include <iostream>
 #include <chrono>
@@ -14,6 +18,8 @@
 std::atomic<bool> should_select_template(false);
 std::atomic<bool> should_quit(false);
 std::atomic<bool> should_reset_tracking(false);
+std::atomic<bool> should_toggle_gray(false);
+std::atomic<bool> should_dump_profile(false);
 std::atomic<int> mouse_x(320);
 std::atomic<int> mouse_y(240);
 std::atomic<bool> mouse_left_click(false);
@@ -58,7 +64,7 @@ void listInputDevices() {
 
 // Mouse input thread function
 void mouseInputThread() {
-    std::cout << "Mouse input thread started..." << std::endl;
+    LOG_INFO("Mouse input thread started...");
     
     struct libevdev *dev = NULL;
     int fd = -1;
@@ -88,7 +94,7 @@ void mouseInputThread() {
     for (int i = 0; device_paths[i] != NULL; i++) {
         fd = open(device_paths[i], O_RDONLY | O_NONBLOCK);
         if (fd < 0) {
-            std::cout << "Failed to open " << device_paths[i] << std::endl;
+            LOG_INFO("Failed to open %s", device_paths[i]);
             continue;
         }
         
@@ -97,17 +103,16 @@ void mouseInputThread() {
             continue;
         }
         
-        std::cout << "Testing device: " << libevdev_get_name(dev) << std::endl;
+        LOG_INFO("Testing device: %s", libevdev_get_name(dev));
         
         // Check if this is a mouse (has relative events and left button)
         if (libevdev_has_event_type(dev, EV_REL) && 
             libevdev_has_event_code(dev, EV_KEY, BTN_LEFT)) {
-            std::cout << "✓ Found mouse: " << libevdev_get_name(dev) 
-                      << " at " << device_paths[i] << std::endl;
+            LOG_INFO("✓ Found mouse: %s at %s", libevdev_get_name(dev), device_paths[i]);
             mouse_available = true;
             break;
         } else {
-            std::cout << "✗ Not a mouse: " << libevdev_get_name(dev) << std::endl;
+            LOG_INFO("✗ Not a mouse: %s", libevdev_get_name(dev));
             libevdev_free(dev);
             close(fd);
             dev = NULL;
@@ -116,14 +121,14 @@ void mouseInputThread() {
     }
     
     if (dev == NULL) {
-        std::cerr << "No suitable mouse device found!" << std::endl;
+        LOG_ERROR("No suitable mouse device found!");
         return;
     }
     
     // Grab the device to get exclusive access
     libevdev_grab(dev, LIBEVDEV_GRAB);
     
-    std::cout << "Mouse initialized successfully!" << std::endl;
+    LOG_INFO("Mouse initialized successfully!");
     
     while (!should_quit) {
         struct input_event ev;
@@ -146,13 +151,13 @@ void mouseInputThread() {
                     mouse_left_click = (ev.value == 1); // 1 = pressed, 0 = released
                     
                     if (mouse_left_click && !was_clicked) {
-                        std::cout << "Left mouse click at: " << mouse_x << ", " << mouse_y << std::endl;
+                        LOG_INFO("Left mouse click at: %d, %d", mouse_x.load(), mouse_y.load());
                         should_select_template = true;
                     }
                 } else if (ev.code == BTN_RIGHT) {
                     // Right click to reset tracking
                     if (ev.value == 1) {
-                        std::cout << "Right mouse click - reset tracking" << std::endl;
+                        LOG_INFO("Right mouse click - reset tracking");
                         should_reset_tracking = true;
                     }
                 }
@@ -170,13 +175,13 @@ void mouseInputThread() {
     libevdev_grab(dev, LIBEVDEV_UNGRAB);
     libevdev_free(dev);
     close(fd);
-    std::cout << "Mouse input thread stopped." << std::endl;
+    LOG_INFO("Mouse input thread stopped.");
 }
 
 // Keyboard input thread function
 void keyboardInputThread() {
-    std::cout << "Keyboard control thread started..." << std::endl;
-    std::cout << "Press 'q' to quit, 'r' to reset tracking, 'm' to show mouse position" << std::endl;
+    LOG_INFO("Keyboard control thread started...");
+    LOG_INFO("Press 'q' to quit, 'r' to reset tracking, 'g' to toggle grayscale, 'p' to dump the stage profile, 'm' to show mouse position");
     
     while (!should_quit) {
         char key = std::cin.get();
@@ -184,21 +189,30 @@ void keyboardInputThread() {
             case 'q':
             case 'Q':
                 should_quit = true;
-                std::cout << "Quit signal received..." << std::endl;
+                LOG_INFO("Quit signal received...");
                 break;
             case 'r':
             case 'R':
                 should_reset_tracking = true;
-                std::cout << "Reset tracking requested..." << std::endl;
+                LOG_INFO("Reset tracking requested...");
                 break;
             case 's':
             case 'S':
                 should_select_template = true;
-                std::cout << "Template selection requested..." << std::endl;
+                LOG_INFO("Template selection requested...");
+                break;
+            case 'g':
+            case 'G':
+                should_toggle_gray = true;
+                LOG_INFO("Grayscale toggle requested...");
+                break;
+            case 'p':
+            case 'P':
+                should_dump_profile = true;
                 break;
             case 'm':
             case 'M':
-                std::cout << "Mouse position: " << mouse_x << ", " << mouse_y << std::endl;
+                LOG_INFO("Mouse position: %d, %d", mouse_x.load(), mouse_y.load());
                 break;
             default:
                 break;
@@ -207,28 +221,96 @@ void keyboardInputThread() {
 }
 
 // Function to select template around mouse position
-cv::Rect selectTemplateAtMouse(const cv::Mat& frame, int mouse_x, int mouse_y, int size = 32) {
+cv::Rect selectTemplateAtMouse(const cv::Size& frame_size, int mouse_x, int mouse_y, int size = 32) {
     int half_size = size / 2;
     
     int x = std::max(0, mouse_x - half_size);
     int y = std::max(0, mouse_y - half_size);
-    int width = std::min(size, frame.cols - x);
-    int height = std::min(size, frame.rows - y);
+    int width = std::min(size, frame_size.width - x);
+    int height = std::min(size, frame_size.height - y);
     
     return cv::Rect(x, y, width, height);
 }
 
-int main() {
-    std::cout << "Starting Visual Tracker on Orange Pi 5..." << std::endl;
-    std::cout << "Mouse controls: Left click to select template, Right click to reset" << std::endl;
-    std::cout << "Keyboard: 'q'=quit, 'r'=reset, 's'=select template, 'm'=show mouse position" << std::endl;
+int main(int argc, char** argv) {
+    // --backend=opencl|native|auto picks the tracker implementation (default auto).
+    // --replay=PATH runs headless over a video or image directory, see replay.h.
+    // --log-level=debug|info|warning|error|off filters the async logger (default info).
+    // --display-scale=1|2|4|8 decodes the display at 1/N and only tracked regions in full
+    // (default 2); 1 decodes every camera frame in full.
+    // --search-margin=N makes replay search a fixed window instead of the motion-predicted one.
+    // --template-rate=R blends confident matches into the template at rate R (default 0.05, 0 = off).
+    BackendType backend_type = BackendType::Auto;
+    bool profile = false;
+    ReplayOptions replay;
+    int camera_display_scale = 2;
+    float template_rate = 0.05f;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t eq = arg.find('=');
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (arg == "--backend=opencl") {
+            backend_type = BackendType::OpenCL;
+        } else if (arg == "--backend=native") {
+            backend_type = BackendType::Native;
+        } else if (arg == "--backend=auto") {
+            backend_type = BackendType::Auto;
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg.compare(0, 9, "--replay=") == 0) {
+            replay.input = value;
+        } else if (arg.compare(0, 6, "--roi=") == 0 && parseRoi(value, replay.roi)) {
+            // ROI parsed
+        } else if (arg.compare(0, 11, "--roi-file=") == 0) {
+            replay.roi_file = value;
+        } else if (arg.compare(0, 9, "--output=") == 0) {
+            replay.output = value;
+        } else if (arg.compare(0, 16, "--search-margin=") == 0 && std::atoi(value.c_str()) > 0) {
+            replay.search_margin = std::atoi(value.c_str());
+        } else if (arg.compare(0, 16, "--template-rate=") == 0 && std::atof(value.c_str()) >= 0.0) {
+            template_rate = static_cast<float>(std::atof(value.c_str()));
+            replay.template_rate = template_rate;
+        } else if (arg == "--display-scale=1" || arg == "--display-scale=2" ||
+                   arg == "--display-scale=4" || arg == "--display-scale=8") {
+            camera_display_scale = std::atoi(value.c_str());
+        } else if (arg.compare(0, 12, "--log-level=") == 0) {
+            LogLevel level;
+            if (!Logger::parseLevel(value, level)) {
+                std::cerr << "Unknown log level: " << value << std::endl;
+                return -1;
+            }
+            Logger::setLevel(level);
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return -1;
+        }
+    }
+    
+    LOG_INFO("Starting Visual Tracker on Orange Pi 5...");
+    
+    // Headless replay needs no camera, framebuffer or input threads
+    if (!replay.input.empty()) {
+        std::unique_ptr<TrackerBackend> tracker = createTrackerBackend(backend_type);
+        if (!tracker) {
+            LOG_ERROR("Failed to initialize tracker!");
+            return -1;
+        }
+        LOG_INFO("Using %s tracker backend", tracker->getName());
+        tracker->setProfiling(profile);
+        return runReplay(*tracker, replay);
+    }
+    
+    LOG_INFO("Mouse controls: Left click to select template, Right click to reset");
+    LOG_INFO("Keyboard: 'q'=quit, 'r'=reset, 's'=select template, 'm'=show mouse position");
     
     // Initialize tracker
-    VisualTracker tracker;
-    if (!tracker.initialize()) {
-        std::cerr << "Failed to initialize tracker!" << std::endl;
+    std::unique_ptr<TrackerBackend> tracker = createTrackerBackend(backend_type);
+    if (!tracker) {
+        LOG_ERROR("Failed to initialize tracker!");
         return -1;
     }
+    LOG_INFO("Using %s tracker backend", tracker->getName());
+    tracker->setProfiling(profile);
 
 
 
@@ -237,61 +319,67 @@ int main() {
 
 
     // Open camera
-    cv::VideoCapture cap(11, cv::CAP_V4L2); // V4L2 camera
-    if (!cap.isOpened()) {
-        std::cerr << "Failed to open camera!" << std::endl;
+    CameraCapture camera;
+    if (!camera.open(11, 1920, 1080, 30, camera_display_scale)) { // V4L2 camera
+        LOG_ERROR("Failed to open camera!");
         return -1;
     }
     
-    // Set camera resolution
-    cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc('M','J','P','G'));
-    cap.set(cv::CAP_PROP_FRAME_WIDTH, 1920);
-    cap.set(cv::CAP_PROP_FRAME_HEIGHT, 1080);
-    cap.set(cv::CAP_PROP_FPS, 30);
-    
-    std::cout << "Camera opened successfully!" << std::endl;
+    LOG_INFO("Camera opened successfully!");
 
     // Initialize framebuffer
     Framebuffer fb;
     if (!fb.init()) {
-        std::cerr << "Cannot init framebuffer" << std::endl;
+        LOG_ERROR("Cannot init framebuffer");
         return 1;
     }
 
     // Start display thread
     fb.startDisplayThread();
-    std::cout << "Framebuffer display started..." << std::endl;
+    LOG_INFO("Framebuffer display started...");
 
+    // Capture and decode run on their own thread; the loop below always gets the newest frame
+    camera.start();
+    
     // Start input threads
     std::thread mouse_thread(mouseInputThread);
     std::thread keyboard_thread(keyboardInputThread);
 
-    cv::Mat frame;
     bool tracking = false;
     cv::Rect template_roi;
     cv::Point track_point;
     float confidence = 0.0f;
+    MotionModel motion;
+    std::chrono::steady_clock::time_point last_frame_time;
+    
+    // Frame N is submitted before the result of frame N-1 is collected, so the tracker
+    // works on one frame while the loop draws the previous one's match
+    uint64_t pending_ticket = 0;
+    cv::Rect pending_roi;
+    std::chrono::steady_clock::time_point pending_timestamp;
     
     // Wait a bit for mouse detection
     std::this_thread::sleep_for(std::chrono::milliseconds(500));
     
     if (!mouse_available) {
-        std::cout << "WARNING: Mouse not detected. Using keyboard controls only." << std::endl;
-        std::cout << "Press 's' to select template at center, 'r' to reset" << std::endl;
+        LOG_WARNING("Mouse not detected. Using keyboard controls only.");
+        LOG_INFO("Press 's' to select template at center, 'r' to reset");
     }
     
     // Main loop
     while (!should_quit) {
-        // Capture frame
-        cap >> frame;
-        if (frame.empty()) {
-            std::cerr << "Failed to grab frame!" << std::endl;
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // Wait for the next frame from the capture thread
+        const CapturedFrame* captured = camera.waitForFrame(100);
+        if (!captured) {
             continue;
         }
+        // Tracking works in full-frame coordinates; only the regions it reads are decoded
+        // at full resolution
+        const cv::Size frame_size = captured->size;
         
-        // Display frame with mouse cursor and status
-        cv::Mat display_frame = frame.clone();
+        // Mouse cursor and status are drawn by the display thread on top of the
+        // scaled display image, in full-frame coordinates
+        Overlay overlay(frame_size);
         
         // Draw mouse cursor if available
         int current_mouse_x = mouse_x;
@@ -299,52 +387,55 @@ int main() {
         
         if (mouse_available) {
             // Draw crosshair for mouse
-            cv::line(display_frame, 
-                    cv::Point(current_mouse_x - 10, current_mouse_y),
-                    cv::Point(current_mouse_x + 10, current_mouse_y),
-                    cv::Scalar(255, 255, 0), 2);
-            cv::line(display_frame, 
-                    cv::Point(current_mouse_x, current_mouse_y - 10),
-                    cv::Point(current_mouse_x, current_mouse_y + 10),
-                    cv::Scalar(255, 255, 0), 2);
+            cv::Point cursor(current_mouse_x, current_mouse_y);
+            overlay.line(cv::Point(cursor.x - 10, cursor.y), cv::Point(cursor.x + 10, cursor.y),
+                         cv::Scalar(255, 255, 0), 2);
+            overlay.line(cv::Point(cursor.x, cursor.y - 10), cv::Point(cursor.x, cursor.y + 10),
+                         cv::Scalar(255, 255, 0), 2);
             
             // Draw template area preview when not tracking
             if (!tracking) {
-                cv::Rect preview_roi = selectTemplateAtMouse(frame, current_mouse_x, current_mouse_y);
-                cv::rectangle(display_frame, preview_roi, cv::Scalar(0, 255, 255), 2);
-                cv::putText(display_frame, "Template Preview", 
+                cv::Rect preview_roi = selectTemplateAtMouse(frame_size, current_mouse_x, current_mouse_y);
+                overlay.rectangle(preview_roi, cv::Scalar(0, 255, 255), 2);
+                overlay.text("Template Preview", 
                            cv::Point(preview_roi.x, preview_roi.y - 5), 
-                           cv::FONT_HERSHEY_SIMPLEX, 0.4, cv::Scalar(0, 255, 255), 1);
+                           0.4, cv::Scalar(0, 255, 255), 1);
             }
         } else {
             // Show center marker when no mouse
-            cv::Point center(frame.cols/2, frame.rows/2);
-            cv::circle(display_frame, center, 5, cv::Scalar(0, 0, 255), -1);
-            cv::circle(display_frame, center, 40, cv::Scalar(0, 0, 255), 2);
+            cv::Point center(frame_size.width/2, frame_size.height/2);
+            overlay.circle(center, 5, cv::Scalar(0, 0, 255), -1);
+            overlay.circle(center, 40, cv::Scalar(0, 0, 255), 2);
         }
         
         // Handle template selection FIRST (before tracking logic)
         // Handle template selection FIRST (before tracking logic)
         if (should_select_template && !tracking) {
             if (mouse_available) {
-                template_roi = selectTemplateAtMouse(frame, current_mouse_x, current_mouse_y);
+                template_roi = selectTemplateAtMouse(frame_size, current_mouse_x, current_mouse_y);
             } else {
                 // Fallback: select center template
-                template_roi = selectTemplateAtMouse(frame, frame.cols/2, frame.rows/2);
+                template_roi = selectTemplateAtMouse(frame_size, frame_size.width/2, frame_size.height/2);
             }
             
-            if (template_roi.width > 20 && template_roi.height > 20) {
-                cv::Mat template_img = frame(template_roi);
+            cv::Mat template_img;
+            if (template_roi.width > 20 && template_roi.height > 20 &&
+                camera.decodeRegion(*captured, template_roi, template_img)) {
                 
                 // Remove the if condition since setTemplate returns void
-                tracker.setTemplate(template_img);
+                tracker->setTemplate(template_img);
                 track_point = cv::Point(template_roi.x + template_roi.width / 2, 
                                     template_roi.y + template_roi.height / 2);
+                motion.reset(track_point);
+                last_frame_time = captured->timestamp;
+                pending_ticket = 0;
                 tracking = true;
-                std::cout << "Template set! Starting tracking..." << std::endl;
-                std::cout << "Template ROI: " << template_roi << std::endl;
+                LOG_INFO("Template set! Starting tracking...");
+                LOG_INFO("Template ROI: %dx%d at (%d, %d)", template_roi.width, template_roi.height,
+                         template_roi.x, template_roi.y);
             } else {
-                std::cerr << "Template ROI too small: " << template_roi << std::endl;
+                LOG_WARNING("Template ROI too small: %dx%d at (%d, %d)", template_roi.width, template_roi.height,
+                            template_roi.x, template_roi.y);
             }
             
             should_select_template = false;
@@ -353,100 +444,139 @@ int main() {
         // Handle tracking reset
         if (should_reset_tracking) {
             tracking = false;
-            std::cout << "Tracking reset." << std::endl;
+            pending_ticket = 0;
+            LOG_INFO("Tracking reset.");
             should_reset_tracking = false;
         }
         
+        // Switch between BGR and luma tracking; the tracker re-applies the current template
+        if (should_toggle_gray) {
+            bool gray = tracker->getColorMode() != ColorMode::Gray;
+            tracker->setColorMode(gray ? ColorMode::Gray : ColorMode::Bgr);
+            pending_ticket = 0;
+            LOG_INFO("Tracking in %s mode.", gray ? "grayscale" : "color");
+            should_toggle_gray = false;
+        }
+        
+        if (should_dump_profile) {
+            tracker->dumpProfile(std::cout);
+            should_dump_profile = false;
+        }
+        
         // Perform tracking if active
         if (tracking) {
             auto start = std::chrono::high_resolution_clock::now();
             
-            // Create search region around tracked point
-            int search_margin = 100;
-            cv::Rect search_roi(
-                std::max(0, track_point.x - search_margin),
-                std::max(0, track_point.y - search_margin),
-                std::min(frame.cols - (track_point.x - search_margin), search_margin * 2),
-                std::min(frame.rows - (track_point.y - search_margin), search_margin * 2)
-            );
+            // Search around where the motion model expects the target in this frame; the
+            // window is sized from the prediction's uncertainty. The model has not seen the
+            // previous frame's match yet, so predict on a copy across both frame gaps.
+            MotionModel lookahead = motion;
+            lookahead.predict(std::chrono::duration<double>(captured->timestamp - last_frame_time).count());
+            cv::Rect search_roi = lookahead.searchWindow(template_roi.size(), frame_size);
             
-            if (search_roi.width > 50 && search_roi.height > 50) {
-                cv::Mat search_region = frame(search_roi);
+            uint64_t ticket = 0;
+            cv::Mat search_region;
+            if (search_roi.width > template_roi.width && search_roi.height > template_roi.height &&
+                camera.decodeRegion(*captured, search_roi, search_region)) {
+                ticket = tracker->submit(search_region);
+            }
+            
+            // Collect the previous frame while this one is tracked; the overlay shows its match
+            std::chrono::steady_clock::time_point result_timestamp = captured->timestamp;
+            if (pending_ticket != 0) {
+                double dt = std::chrono::duration<double>(pending_timestamp - last_frame_time).count();
+                last_frame_time = pending_timestamp;
+                result_timestamp = pending_timestamp;
+                motion.predict(dt);
                 
-                if (tracker.track(search_region, track_point, confidence)) {
+                if (tracker->wait(pending_ticket, track_point, confidence)) {
                     // Convert back to full frame coordinates
-                    track_point.x += search_roi.x;
-                    track_point.y += search_roi.y;
+                    track_point.x += pending_roi.x;
+                    track_point.y += pending_roi.y;
+                    motion.correct(track_point, confidence);
                     
                     // Draw tracking result
-                    cv::circle(display_frame, track_point, 8, cv::Scalar(0, 255, 0), 2);
-                    cv::circle(display_frame, track_point, 3, cv::Scalar(0, 255, 0), -1);
+                    overlay.circle(track_point, 8, cv::Scalar(0, 255, 0), 2);
+                    overlay.circle(track_point, 3, cv::Scalar(0, 255, 0), -1);
                     
                     // Draw search region
-                    cv::rectangle(display_frame, search_roi, cv::Scalar(255, 255, 0), 2);
+                    overlay.rectangle(pending_roi, cv::Scalar(255, 255, 0), 2);
                     
                     // Draw original template location
-                    cv::rectangle(display_frame, template_roi, cv::Scalar(0, 255, 255), 1);
+                    overlay.rectangle(template_roi, cv::Scalar(0, 255, 255), 1);
                     
                     // Display status
                     std::string status_text = "Tracking: " + std::to_string(confidence).substr(0, 4);
-                    cv::putText(display_frame, status_text, 
-                               cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.7, 
+                    overlay.text(status_text, 
+                               cv::Point(10, 30), 0.7, 
                                cv::Scalar(0, 255, 0), 2);
                     
                     // Display tracking point coordinates
                     std::string coord_text = "Pos: " + std::to_string(track_point.x) + "," + std::to_string(track_point.y);
-                    cv::putText(display_frame, coord_text, 
-                               cv::Point(10, 90), cv::FONT_HERSHEY_SIMPLEX, 0.5, 
+                    overlay.text(coord_text, 
+                               cv::Point(10, 90), 0.5, 
                                cv::Scalar(255, 255, 255), 1);
-                    // if (confidence>0.97){
-                    //     template_roi = selectTemplateAtMouse(frame, track_point.x, track_point.y);                        
-                    //     cv::Mat template_img = frame(template_roi);
-                    //     tracker.setTemplate(template_img);
-                    // }
+                    
+                    // Let the template follow gradual appearance changes; only confident
+                    // matches are blended in so the template does not drift onto background.
+                    // The frame already in flight still correlates against the old template.
+                    if (template_rate > 0.0f && confidence > 0.97f) {
+                        tracker->updateTemplate(template_rate);
+                    }
                 } else {
-                    cv::putText(display_frame, "Tracking lost!", cv::Point(10, 30), 
-                               cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 0, 255), 2);
+                    overlay.text("Tracking lost!", cv::Point(10, 30), 
+                               0.7, cv::Scalar(0, 0, 255), 2);
+                    // The prediction keeps coasting and the window widens every frame
+                    // until the target is found again
+                    overlay.rectangle(pending_roi, cv::Scalar(0, 0, 255), 1);
                     // Don't reset tracking automatically - let user decide
                 }
             }
+            pending_ticket = ticket;
+            pending_roi = search_roi;
+            pending_timestamp = captured->timestamp;
             
             auto end = std::chrono::high_resolution_clock::now();
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
             if (duration.count() > 0) {
                 std::string fps_text = "FPS: " + std::to_string(1000.0 / duration.count()).substr(0, 4);
-                cv::putText(display_frame, fps_text, 
-                           cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 0.7, 
+                overlay.text(fps_text, 
+                           cv::Point(10, 60), 0.7, 
                            cv::Scalar(255, 255, 255), 2);
             }
+            
+            // Time from the camera handing over the frame to the tracking result
+            auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - result_timestamp);
+            std::string latency_text = "Latency: " + std::to_string(latency.count()) + " ms";
+            overlay.text(latency_text, 
+                       cv::Point(10, 120), 0.7, 
+                       cv::Scalar(255, 255, 255), 2);
         } else {
             // Show instructions
             if (mouse_available) {
-                cv::putText(display_frame, "Left click to select template", 
-                           cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.6, 
+                overlay.text("Left click to select template", 
+                           cv::Point(10, 30), 0.6, 
                            cv::Scalar(255, 255, 255), 1);
-                cv::putText(display_frame, "Right click to reset, 'q' to quit", 
-                           cv::Point(10, 50), cv::FONT_HERSHEY_SIMPLEX, 0.6, 
+                overlay.text("Right click to reset, 'q' to quit", 
+                           cv::Point(10, 50), 0.6, 
                            cv::Scalar(255, 255, 255), 1);
             } else {
-                cv::putText(display_frame, "Press 's' to select template at center", 
-                           cv::Point(10, 30), cv::FONT_HERSHEY_SIMPLEX, 0.6, 
+                overlay.text("Press 's' to select template at center", 
+                           cv::Point(10, 30), 0.6, 
                            cv::Scalar(255, 255, 255), 1);
-                cv::putText(display_frame, "Press 'q' to quit, 'r' to reset", 
-                           cv::Point(10, 50), cv::FONT_HERSHEY_SIMPLEX, 0.6, 
+                overlay.text("Press 'q' to quit, 'r' to reset", 
+                           cv::Point(10, 50), 0.6, 
                            cv::Scalar(255, 255, 255), 1);
             }
         }
         
-        // Push frame to framebuffer
-        fb.pushFrame(display_frame);
-        
-        // Small delay
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        // Push frame to framebuffer; the display image is shared with the display thread, not copied
+        fb.pushFrame(cv::Mat(captured->display), std::move(overlay));
     }
     
     // Cleanup
-    std::cout << "Shutting down..." << std::endl;
+    LOG_INFO("Shutting down...");
     should_quit = true;
     
     if (mouse_thread.joinable()) {
@@ -456,9 +586,11 @@ int main() {
         keyboard_thread.join();
     }
     
-    cap.release();
+    camera.stop();
+    LOG_INFO("Camera frames skipped by the tracking loop: %llu",
+             static_cast<unsigned long long>(camera.getSkippedCount()));
     fb.stop();
     
-    std::cout << "Application terminated." << std::endl;
+    LOG_INFO("Application terminated.");
     return 0;
 }
\ No newline at end of file
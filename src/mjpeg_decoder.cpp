@@ -0,0 +1,130 @@
+#include "mjpeg_decoder.h"
+#include "logger.h"
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <jpeglib.h>
+
+namespace {
+
+struct ErrorManager {
+    jpeg_error_mgr mgr;
+    jmp_buf jump;
+};
+
+// Fatal errors unwind back into the decode call that started the decompressor
+void onJpegError(j_common_ptr cinfo) {
+    ErrorManager* error = reinterpret_cast<ErrorManager*>(cinfo->err);
+    char message[JMSG_LENGTH_MAX];
+    cinfo->err->format_message(cinfo, message);
+    LOG_EVERY_MS(LogLevel::Warning, 1000, "MJPEG decode failed: %s", message);
+    longjmp(error->jump, 1);
+}
+
+// Corrupt-data warnings are routine with USB cameras; keep them out of the console
+void onJpegMessage(j_common_ptr cinfo) {
+    char message[JMSG_LENGTH_MAX];
+    cinfo->err->format_message(cinfo, message);
+    LOG_EVERY_MS(LogLevel::Debug, 1000, "MJPEG: %s", message);
+}
+
+} // namespace
+
+struct MjpegDecoder::Context {
+    jpeg_decompress_struct cinfo;
+    ErrorManager error;
+};
+
+MjpegDecoder::MjpegDecoder() : context(new Context()) {
+    context->cinfo.err = jpeg_std_error(&context->error.mgr);
+    context->error.mgr.error_exit = onJpegError;
+    context->error.mgr.output_message = onJpegMessage;
+    jpeg_create_decompress(&context->cinfo);
+}
+
+MjpegDecoder::~MjpegDecoder() {
+    jpeg_destroy_decompress(&context->cinfo);
+    delete context;
+}
+
+bool MjpegDecoder::readSize(const uint8_t* data, size_t size, cv::Size& frame_size) {
+    jpeg_decompress_struct& cinfo = context->cinfo;
+    if (setjmp(context->error.jump)) {
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_mem_src(&cinfo, data, size);
+    jpeg_read_header(&cinfo, TRUE);
+    frame_size = cv::Size(cinfo.image_width, cinfo.image_height);
+    jpeg_abort_decompress(&cinfo);
+    return true;
+}
+
+bool MjpegDecoder::decodeScaled(const uint8_t* data, size_t size, int scale_denom, cv::Mat& bgr) {
+    jpeg_decompress_struct& cinfo = context->cinfo;
+    if (setjmp(context->error.jump)) {
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_mem_src(&cinfo, data, size);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_EXT_BGR;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = scale_denom;
+    // Display output only; the fast integer IDCT is visually identical at these scales
+    cinfo.dct_method = JDCT_IFAST;
+    jpeg_start_decompress(&cinfo);
+
+    bgr.create(cinfo.output_height, cinfo.output_width, CV_8UC3);
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = bgr.ptr<uchar>(cinfo.output_scanline);
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_decompress(&cinfo);
+    return true;
+}
+
+bool MjpegDecoder::decodeRegion(const uint8_t* data, size_t size, const cv::Rect& roi, cv::Mat& bgr) {
+    jpeg_decompress_struct& cinfo = context->cinfo;
+    if (setjmp(context->error.jump)) {
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_mem_src(&cinfo, data, size);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_EXT_BGR;
+
+    cv::Rect region = roi & cv::Rect(0, 0, cinfo.image_width, cinfo.image_height);
+    if (region.empty()) {
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+    jpeg_start_decompress(&cinfo);
+
+    // Pad the column range by one MCU so chroma upsampling at its edges sees the same
+    // neighbours as a full decode; libjpeg then aligns it to iMCUs and decodes only those.
+    // Rows above the region are entropy-decoded but skip IDCT, upsampling and colour conversion.
+    const int kEdgePadding = 16;
+    JDIMENSION crop_x = std::max(0, region.x - kEdgePadding);
+    JDIMENSION crop_width = std::min<int>(region.br().x + kEdgePadding, cinfo.image_width) - crop_x;
+    jpeg_crop_scanline(&cinfo, &crop_x, &crop_width);
+    jpeg_skip_scanlines(&cinfo, region.y);
+
+    row_buffer.create(1, cinfo.output_width * 3, CV_8U);
+    bgr.create(region.height, region.width, CV_8UC3);
+    size_t column_offset = (region.x - crop_x) * 3;
+    size_t row_bytes = region.width * 3;
+    for (int y = 0; y < region.height; y++) {
+        JSAMPROW row = row_buffer.ptr<uchar>();
+        jpeg_read_scanlines(&cinfo, &row, 1);
+        std::memcpy(bgr.ptr<uchar>(y), row + column_offset, row_bytes);
+    }
+
+    // Rows below the region are never touched
+    jpeg_abort_decompress(&cinfo);
+    return true;
+}
@@ -0,0 +1,117 @@
+#include "motion_model.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// White-noise acceleration spectral density (px^2/s^3): how far the target may depart
+// from constant velocity. Roughly a 1 g swing of a hand-held camera at 1080p.
+const double kAccelerationNoise = 4.0e6;
+
+// Standard deviation of a confident match and of the initial velocity guess
+const double kMeasurementSigma = 1.0;
+const double kInitialVelocitySigma = 300.0;
+
+// Confidence below this is treated as this, so a poor match still moves the filter a little
+const float kMinConfidence = 0.1f;
+
+// Window half-size beyond the template: n_sigma of position uncertainty, at least kMinMargin
+const double kWindowSigmas = 3.0;
+const int kMinMargin = 16;
+const int kDefaultMaxMargin = 200;
+
+// Frame gaps longer than this (stalls, dropped bursts) are extrapolated as if this long
+const double kMaxStep = 0.5;
+
+int alignUp(int value, int alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+void MotionModel::Axis::predict(double dt, double acceleration_noise) {
+    position += velocity * dt;
+
+    // P = F P F^T + Q with F = [1 dt; 0 1] and the discrete white-noise acceleration Q
+    double dt2 = dt * dt;
+    p00 += 2.0 * dt * p01 + dt2 * p11 + acceleration_noise * dt2 * dt / 3.0;
+    p01 += dt * p11 + acceleration_noise * dt2 / 2.0;
+    p11 += acceleration_noise * dt;
+}
+
+void MotionModel::Axis::correct(double measured, double measurement_variance) {
+    double innovation = measured - position;
+    double s = p00 + measurement_variance;
+    double k0 = p00 / s;
+    double k1 = p01 / s;
+
+    position += k0 * innovation;
+    velocity += k1 * innovation;
+
+    // P = (I - K H) P with H = [1 0]
+    p11 -= k1 * p01;
+    p01 -= k0 * p01;
+    p00 -= k0 * p00;
+}
+
+MotionModel::MotionModel() : initialized(false), max_margin(kDefaultMaxMargin) {
+    reset(cv::Point2f(0.0f, 0.0f));
+    initialized = false;
+}
+
+void MotionModel::reset(const cv::Point2f& position) {
+    const double coordinates[2] = { position.x, position.y };
+    for (int i = 0; i < 2; i++) {
+        axes[i].position = coordinates[i];
+        axes[i].velocity = 0.0;
+        axes[i].p00 = kMeasurementSigma * kMeasurementSigma;
+        axes[i].p01 = 0.0;
+        axes[i].p11 = kInitialVelocitySigma * kInitialVelocitySigma;
+    }
+    initialized = true;
+}
+
+bool MotionModel::isInitialized() const {
+    return initialized;
+}
+
+cv::Point2f MotionModel::predict(double dt) {
+    dt = std::min(std::max(dt, 0.0), kMaxStep);
+    for (int i = 0; i < 2; i++) {
+        axes[i].predict(dt, kAccelerationNoise);
+    }
+    return getPosition();
+}
+
+void MotionModel::correct(const cv::Point2f& measured, float confidence) {
+    float weight = std::max(std::min(confidence, 1.0f), kMinConfidence);
+    double variance = kMeasurementSigma * kMeasurementSigma / (weight * weight);
+    axes[0].correct(measured.x, variance);
+    axes[1].correct(measured.y, variance);
+}
+
+cv::Rect MotionModel::searchWindow(const cv::Size& template_size, const cv::Size& frame_size) const {
+    int sides[2];
+    for (int i = 0; i < 2; i++) {
+        int margin = static_cast<int>(std::ceil(kWindowSigmas * std::sqrt(axes[i].p00)));
+        margin = std::min(std::max(margin, kMinMargin), max_margin);
+        int template_side = i == 0 ? template_size.width : template_size.height;
+        sides[i] = alignUp(template_side + 2 * margin, kWindowAlignment);
+    }
+
+    cv::Point2f center = getPosition();
+    cv::Rect window(cvRound(center.x) - sides[0] / 2, cvRound(center.y) - sides[1] / 2, sides[0], sides[1]);
+    return window & cv::Rect(0, 0, frame_size.width, frame_size.height);
+}
+
+cv::Point2f MotionModel::getPosition() const {
+    return cv::Point2f(static_cast<float>(axes[0].position), static_cast<float>(axes[1].position));
+}
+
+cv::Point2f MotionModel::getVelocity() const {
+    return cv::Point2f(static_cast<float>(axes[0].velocity), static_cast<float>(axes[1].velocity));
+}
+
+void MotionModel::setMaxMargin(int margin) {
+    max_margin = std::max(margin, kMinMargin);
+}
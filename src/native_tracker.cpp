@@ -0,0 +1,399 @@
+#include "native_tracker.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <iostream>
+#include <thread>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Reasonable confidence threshold for NCC, same as the OpenCL backend
+const float kConfidenceThreshold = 0.6f;
+
+// Submitted ROIs kept for tickets that are never waited for; the oldest is dropped first
+const size_t kMaxPendingRegions = 16;
+
+// Cores of the highest capacity on a big.LITTLE CPU (the A76 cores 4-7 of the RK3588),
+// from the scheduler's per-core capacity. Empty when every core is the same or the
+// capacities are not exposed, as on most x86 hosts.
+std::vector<int> detectBigCores(unsigned hardware_threads) {
+    std::vector<int> capacities;
+    for (unsigned cpu = 0; cpu < hardware_threads; cpu++) {
+        std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpu_capacity");
+        int capacity = 0;
+        if (!(file >> capacity)) {
+            return std::vector<int>();
+        }
+        capacities.push_back(capacity);
+    }
+    
+    std::vector<int> cores;
+    int largest = *std::max_element(capacities.begin(), capacities.end());
+    int smallest = *std::min_element(capacities.begin(), capacities.end());
+    if (largest == smallest) {
+        return cores;
+    }
+    for (size_t cpu = 0; cpu < capacities.size(); cpu++) {
+        if (capacities[cpu] == largest) {
+            cores.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cores;
+}
+
+// Sum of a[i] * b[i] over `length` bytes. Exact as long as length stays below 66000,
+// far more than a template row.
+uint32_t dotProductU8(const uint8_t* a, const uint8_t* b, int length) {
+    int i = 0;
+    uint32_t sum = 0;
+    
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; i + 16 <= length; i += 16) {
+        uint8x16_t va = vld1q_u8(a + i);
+        uint8x16_t vb = vld1q_u8(b + i);
+        acc = vpadalq_u16(acc, vmull_u8(vget_low_u8(va), vget_low_u8(vb)));
+        acc = vpadalq_u16(acc, vmull_u8(vget_high_u8(va), vget_high_u8(vb)));
+    }
+#if defined(__aarch64__)
+    sum = vaddvq_u32(acc);
+#else
+    uint32x2_t pair = vadd_u32(vget_low_u32(acc), vget_high_u32(acc));
+    sum = vget_lane_u32(vpadd_u32(pair, pair), 0);
+#endif
+#elif defined(__AVX2__)
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 16 <= length; i += 16) {
+        __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        __m256i vb = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+    __m128i acc128 = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    acc128 = _mm_add_epi32(acc128, _mm_shuffle_epi32(acc128, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc128 = _mm_add_epi32(acc128, _mm_shuffle_epi32(acc128, _MM_SHUFFLE(2, 3, 0, 1)));
+    sum = static_cast<uint32_t>(_mm_cvtsi128_si32(acc128));
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero)));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero)));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    sum = static_cast<uint32_t>(_mm_cvtsi128_si32(acc));
+#endif
+    
+    for (; i < length; i++) {
+        sum += static_cast<uint32_t>(a[i]) * b[i];
+    }
+    return sum;
+}
+
+} // namespace
+
+NativeTracker::NativeTracker() :
+    color_mode(ColorMode::Bgr),
+    template_initialized(false),
+    template_sum(0),
+    template_norm(0.0f),
+    template_accumulator_valid(false),
+    last_match_valid(false),
+    next_ticket(1)
+{
+}
+
+NativeTracker::~NativeTracker() {
+    if (profiler.isEnabled()) {
+        std::cout << "Native stage profile:" << std::endl;
+        dumpProfile(std::cout);
+    }
+}
+
+bool NativeTracker::initialize() {
+    setThreadCount(0);
+    LOG_INFO("Native NCC Tracker initialized with %d threads", getThreadCount());
+    return true;
+}
+
+void NativeTracker::setThreadCount(int threads) {
+    // On big.LITTLE, workers are pinned to the big cores and the last big core is left to
+    // the framebuffer display thread; elsewhere every hardware thread is used, unpinned
+    unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> cores = detectBigCores(hardware_threads);
+    if (cores.size() > 1) {
+        cores.pop_back();
+    }
+    if (threads <= 0) {
+        threads = cores.empty() ? static_cast<int>(hardware_threads) : static_cast<int>(cores.size()) + 1;
+    }
+    
+    // The calling thread is one of the `threads`
+    thread_pool.reset(new ThreadPool(threads - 1, cores));
+}
+
+int NativeTracker::getThreadCount() const {
+    return thread_pool ? thread_pool->getThreadCount() : 1;
+}
+
+int NativeTracker::channelCount() const {
+    return color_mode == ColorMode::Gray ? 1 : 3;
+}
+
+void NativeTracker::convertForTracking(const cv::Mat& image, cv::Mat& converted) const {
+    if (color_mode == ColorMode::Gray) {
+        cv::cvtColor(image, converted, cv::COLOR_BGR2GRAY);
+    } else {
+        image.copyTo(converted);
+    }
+}
+
+void NativeTracker::setColorMode(ColorMode mode) {
+    if (mode == color_mode) {
+        return;
+    }
+    color_mode = mode;
+    
+    if (template_initialized) {
+        cv::Mat source = template_source;
+        setTemplate(source);
+    }
+}
+
+ColorMode NativeTracker::getColorMode() const {
+    return color_mode;
+}
+
+const char* NativeTracker::getName() const {
+    return "Native";
+}
+
+void NativeTracker::setProfiling(bool enabled) {
+    profiler.setEnabled(enabled);
+}
+
+void NativeTracker::dumpProfile(std::ostream& out) {
+    profiler.dump(out);
+}
+
+void NativeTracker::setTemplate(const cv::Mat& template_roi) {
+    template_source = template_roi.clone();
+    convertForTracking(template_roi, template_image);
+    
+    // Same size limit as the spatial OpenCL kernels
+    if (template_image.cols > 100 || template_image.rows > 100) {
+        cv::resize(template_image, template_image, cv::Size(80, 80));
+    }
+    template_size = template_image.size();
+    computeTemplateStatistics();
+    
+    template_accumulator_valid = false;
+    last_match_valid = false;
+    template_initialized = true;
+    LOG_INFO("Template set with size: %dx%d", template_size.width, template_size.height);
+}
+
+bool NativeTracker::track(const cv::Mat& search_region, cv::Point& location, float& confidence) {
+    if (!template_initialized) {
+        LOG_EVERY_MS(LogLevel::Error, 1000, "Template not initialized!");
+        return false;
+    }
+    
+    last_match_valid = false;
+    
+    std::chrono::steady_clock::time_point track_start = std::chrono::steady_clock::now();
+    convertForTracking(search_region, search_staging);
+    profiler.recordHost("roi_convert", millisecondsSince(track_start));
+    int corr_width = search_staging.cols - template_size.width;
+    int corr_height = search_staging.rows - template_size.height;
+    
+    if (corr_width <= 0 || corr_height <= 0) {
+        LOG_EVERY_MS(LogLevel::Warning, 1000, "Search region too small for template matching!");
+        location = cv::Point(search_region.cols / 2, search_region.rows / 2);
+        confidence = 0.0f;
+        return false;
+    }
+    
+    // Interleaved channels are one plane of width W*C, so a template window is a plain
+    // rectangle in it; the sqsum in doubles is exact for any frame size we handle
+    std::chrono::steady_clock::time_point stage_start = std::chrono::steady_clock::now();
+    cv::integral(search_staging.reshape(1), integral_sum, integral_sqsum, CV_32S, CV_64F);
+    profiler.recordHost("integral", millisecondsSince(stage_start));
+    
+    stage_start = std::chrono::steady_clock::now();
+    row_best_scores.resize(corr_height);
+    row_best_x.resize(corr_height);
+    thread_pool->parallelFor(0, corr_height, [this, corr_width](int row_begin, int row_end) {
+        correlateRows(row_begin, row_end, corr_width);
+    });
+    profiler.recordHost("correlate", millisecondsSince(stage_start));
+    
+    // First maximum in row-major order, like the device argmax
+    int best_x = 0, best_y = 0;
+    float best_correlation = -1.0f;
+    for (int y = 0; y < corr_height; y++) {
+        if (row_best_scores[y] > best_correlation) {
+            best_correlation = row_best_scores[y];
+            best_x = row_best_x[y];
+            best_y = y;
+        }
+    }
+    
+    last_match = cv::Point(best_x, best_y);
+    last_match_valid = true;
+    location = cv::Point(best_x + template_size.width / 2, best_y + template_size.height / 2);
+    confidence = best_correlation;
+    
+    bool success = best_correlation > kConfidenceThreshold;
+    profiler.recordHost("track_total", millisecondsSince(track_start));
+    
+    if (!success) {
+        LOG_EVERY_MS(LogLevel::Warning, 1000, "Low confidence match: %.3f", best_correlation);
+    }
+    
+    return success;
+}
+
+bool NativeTracker::updateTemplate(float learning_rate) {
+    if (!template_initialized || !last_match_valid) {
+        return false;
+    }
+    learning_rate = std::max(0.0f, std::min(learning_rate, 1.0f));
+    
+    // Blend in floats and round into the byte template in place; the patch is still
+    // in search_staging from the last track()
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (!template_accumulator_valid) {
+        template_image.convertTo(template_accumulator, CV_32F);
+        template_accumulator_valid = true;
+    }
+    int row_length = template_size.width * channelCount();
+    for (int y = 0; y < template_size.height; y++) {
+        const uchar* patch = search_staging.ptr<uchar>(last_match.y + y) + last_match.x * channelCount();
+        float* accumulated = template_accumulator.ptr<float>(y);
+        uchar* bytes = template_image.ptr<uchar>(y);
+        for (int i = 0; i < row_length; i++) {
+            accumulated[i] += learning_rate * (patch[i] - accumulated[i]);
+            bytes[i] = cv::saturate_cast<uchar>(accumulated[i]);
+        }
+    }
+    computeTemplateStatistics();
+    
+    last_match_valid = false;
+    profiler.recordHost("template_update", millisecondsSince(start));
+    return true;
+}
+
+uint64_t NativeTracker::submit(const cv::Mat& search_region) {
+    if (!template_initialized) {
+        LOG_EVERY_MS(LogLevel::Error, 1000, "Template not initialized!");
+        return 0;
+    }
+    
+    // Tickets are increasing, so the smallest key is the oldest job
+    if (pending_regions.size() >= kMaxPendingRegions) {
+        pending_regions.erase(pending_regions.begin());
+    }
+    uint64_t ticket = next_ticket++;
+    search_region.copyTo(pending_regions[ticket]);
+    return ticket;
+}
+
+bool NativeTracker::poll(uint64_t ticket) {
+    return pending_regions.count(ticket) > 0;
+}
+
+bool NativeTracker::wait(uint64_t ticket, cv::Point& location, float& confidence) {
+    std::map<uint64_t, cv::Mat>::iterator pending = pending_regions.find(ticket);
+    if (pending == pending_regions.end()) {
+        LOG_EVERY_MS(LogLevel::Error, 1000, "Unknown or already collected tracking ticket: %llu",
+                     static_cast<unsigned long long>(ticket));
+        return false;
+    }
+    cv::Mat search_region = pending->second;
+    pending_regions.erase(pending);
+    return track(search_region, location, confidence);
+}
+
+void NativeTracker::computeTemplateStatistics() {
+    // Integer sum and zero-mean norm, so the NCC numerator can be formed exactly
+    size_t total = template_image.total() * template_image.channels();
+    const uchar* data = template_image.data;
+    int sum = 0;
+    for (size_t i = 0; i < total; i++) {
+        sum += data[i];
+    }
+    double mean = static_cast<double>(sum) / total;
+    double sqsum = 0.0;
+    for (size_t i = 0; i < total; i++) {
+        double value = data[i] - mean;
+        sqsum += value * value;
+    }
+    template_sum = sum;
+    template_norm = static_cast<float>(std::sqrt(sqsum));
+}
+
+void NativeTracker::correlateRows(int row_begin, int row_end, int corr_width) {
+    int channels = channelCount();
+    int row_length = template_size.width * channels;
+    int64_t total_pixels = static_cast<int64_t>(row_length) * template_size.height;
+    
+    for (int y = row_begin; y < row_end; y++) {
+        const int* sum_top = integral_sum.ptr<int>(y);
+        const int* sum_bottom = integral_sum.ptr<int>(y + template_size.height);
+        const double* sqsum_top = integral_sqsum.ptr<double>(y);
+        const double* sqsum_bottom = integral_sqsum.ptr<double>(y + template_size.height);
+        
+        float best_score = -1.0f;
+        int best_x = 0;
+        for (int x = 0; x < corr_width; x++) {
+            int x0 = x * channels;
+            int x1 = x0 + row_length;
+            
+            uint64_t dot = 0;
+            for (int ty = 0; ty < template_size.height; ty++) {
+                dot += dotProductU8(template_image.ptr<uchar>(ty), search_staging.ptr<uchar>(y + ty) + x0, row_length);
+            }
+            
+            int64_t window_sum = static_cast<int64_t>(sum_bottom[x1]) - sum_top[x1] - sum_bottom[x0] + sum_top[x0];
+            int64_t window_sqsum = static_cast<int64_t>(sqsum_bottom[x1] - sqsum_top[x1] - sqsum_bottom[x0] + sqsum_top[x0]);
+            
+            int64_t scaled_numerator = total_pixels * static_cast<int64_t>(dot) - template_sum * window_sum;
+            int64_t scaled_var = total_pixels * window_sqsum - window_sum * window_sum;
+            float numerator = static_cast<float>(scaled_numerator) / total_pixels;
+            float search_var = static_cast<float>(scaled_var) / total_pixels;
+            
+            float correlation = 0.0f;
+            if (template_norm > 1e-3f && search_var > 1e-6f) {
+                correlation = numerator / (template_norm * std::sqrt(search_var));
+                correlation = (correlation + 1.0f) * 0.5f;
+            }
+            
+            if (correlation > best_score) {
+                best_score = correlation;
+                best_x = x;
+            }
+        }
+        
+        row_best_scores[y] = best_score;
+        row_best_x[y] = best_x;
+    }
+}
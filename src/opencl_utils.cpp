@@ -1,8 +1,40 @@
 #include "opencl_utils.h"
+#include "logger.h"
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
 #include <iterator>  // Add this for std::istreambuf_iterato
+#include <cstdio>
+#include <cstdint>
+#include <sys/stat.h>
+
+namespace {
+
+// FNV-1a, enough to tell kernel sources and devices apart
+uint64_t fnv1a(const std::string& data, uint64_t hash = 14695981039346656037ULL) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::string deviceString(cl_device_id device, cl_device_info param) {
+    size_t size = 0;
+    if (clGetDeviceInfo(device, param, 0, NULL, &size) != CL_SUCCESS || size == 0) {
+        return "";
+    }
+    std::vector<char> value(size);
+    if (clGetDeviceInfo(device, param, size, value.data(), NULL) != CL_SUCCESS) {
+        return "";
+    }
+    return std::string(value.data());
+}
+
+} // namespace
+
+std::string OpenCLUtils::program_cache_directory = "kernel_cache";
 
 cl_context OpenCLUtils::createContext() {
     cl_platform_id platform;
@@ -17,7 +49,7 @@ cl_context OpenCLUtils::createContext() {
     // Get GPU device
     error = clGetDeviceIDs(platform, CL_DEVICE_TYPE_GPU, 1, &device, &num_devices);
     if (error != CL_SUCCESS) {
-        std::cout << "No GPU found, trying CPU..." << std::endl;
+        LOG_WARNING("No GPU found, trying CPU...");
         error = clGetDeviceIDs(platform, CL_DEVICE_TYPE_CPU, 1, &device, &num_devices);
     }
     checkError(error, "Failed to get device IDs");
@@ -29,7 +61,7 @@ cl_context OpenCLUtils::createContext() {
     return context;
 }
 
-cl_command_queue OpenCLUtils::createCommandQueue(cl_context context) {
+cl_command_queue OpenCLUtils::createCommandQueue(cl_context context, cl_command_queue_properties properties) {
     cl_int error;
     cl_device_id device;
     
@@ -37,40 +69,162 @@ cl_command_queue OpenCLUtils::createCommandQueue(cl_context context) {
     error = clGetContextInfo(context, CL_CONTEXT_DEVICES, sizeof(cl_device_id), &device, NULL);
     checkError(error, "Failed to get device from context");
     
-    cl_command_queue queue = clCreateCommandQueue(context, device, 0, &error);
+    cl_command_queue queue = clCreateCommandQueue(context, device, properties, &error);
     checkError(error, "Failed to create command queue");
     
     return queue;
 }
 
-cl_program OpenCLUtils::createProgramFromFile(cl_context context, const std::string& filename) {
+cl_program OpenCLUtils::createProgramFromFile(cl_context context, const std::string& filename,
+                                              const std::string& options) {
     std::string source = readKernelSource(filename);
-    const char* source_str = source.c_str();
-    size_t source_size = source.size();
     
     cl_int error;
+    cl_device_id device;
+    error = clGetContextInfo(context, CL_CONTEXT_DEVICES, sizeof(cl_device_id), &device, NULL);
+    checkError(error, "Failed to get device for building");
+    
+    // Try the binary cache first; any mismatch or driver rejection falls through to a source build
+    std::string cache_path;
+    if (!program_cache_directory.empty()) {
+        cache_path = program_cache_directory + "/" + programCacheKey(source, options, device) + ".bin";
+        cl_program cached = loadCachedProgram(context, device, cache_path, options);
+        if (cached) {
+            LOG_INFO("Loaded cached program binary: %s", cache_path.c_str());
+            return cached;
+        }
+    }
+    
+    const char* source_str = source.c_str();
+    size_t source_size = source.size();
     cl_program program = clCreateProgramWithSource(context, 1, &source_str, &source_size, &error);
     checkError(error, "Failed to create program from source");
     
     // Build program
-    cl_device_id device;
-    error = clGetContextInfo(context, CL_CONTEXT_DEVICES, sizeof(cl_device_id), &device, NULL);
-    checkError(error, "Failed to get device for building");
+    buildProgram(program, device, options);
+    
+    if (!cache_path.empty()) {
+        storeCachedProgram(program, cache_path);
+    }
     
-    error = clBuildProgram(program, 1, &device, NULL, NULL, NULL);
+    return program;
+}
+
+void OpenCLUtils::buildProgram(cl_program program, cl_device_id device, const std::string& options) {
+    cl_int error = clBuildProgram(program, 1, &device, options.empty() ? NULL : options.c_str(), NULL, NULL);
     if (error != CL_SUCCESS) {
         // Get build log
         size_t log_size;
         clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &log_size);
         std::vector<char> log(log_size);
         clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, log_size, log.data(), NULL);
-        std::cerr << "Build failed:\n" << log.data() << std::endl;
+        // One record per line; a whole build log would not fit in a log message
+        LOG_ERROR("Build failed:");
+        std::istringstream lines(log.data());
+        std::string line;
+        for (int count = 1; std::getline(lines, line); count++) {
+            LOG_ERROR("%s", line.c_str());
+            // Long logs would overrun this thread's ring before the next drain
+            if (count % 128 == 0) {
+                Logger::instance().flush();
+            }
+        }
+        clReleaseProgram(program);
         throw std::runtime_error("Program build failed");
     }
+}
+
+void OpenCLUtils::setProgramCacheDirectory(const std::string& directory) {
+    program_cache_directory = directory;
+}
+
+const std::string& OpenCLUtils::getProgramCacheDirectory() {
+    return program_cache_directory;
+}
+
+std::string OpenCLUtils::programCacheKey(const std::string& source, const std::string& options,
+                                         cl_device_id device) {
+    // Separators keep e.g. ("ab", "c") and ("a", "bc") from hashing alike
+    uint64_t hash = fnv1a(source);
+    hash = fnv1a("\n" + options, hash);
+    hash = fnv1a("\n" + deviceString(device, CL_DEVICE_NAME), hash);
+    hash = fnv1a("\n" + deviceString(device, CL_DEVICE_VERSION), hash);
+    hash = fnv1a("\n" + deviceString(device, CL_DRIVER_VERSION), hash);
+    
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+    return key;
+}
+
+cl_program OpenCLUtils::loadCachedProgram(cl_context context, cl_device_id device,
+                                          const std::string& path, const std::string& options) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+    std::vector<unsigned char> binary((std::istreambuf_iterator<char>(file)),
+                                      std::istreambuf_iterator<char>());
+    if (binary.empty()) {
+        return nullptr;
+    }
+    
+    const unsigned char* binary_ptr = binary.data();
+    size_t binary_size = binary.size();
+    cl_int binary_status = CL_SUCCESS;
+    cl_int error;
+    cl_program program = clCreateProgramWithBinary(context, 1, &device, &binary_size, &binary_ptr,
+                                                   &binary_status, &error);
+    if (error != CL_SUCCESS || binary_status != CL_SUCCESS) {
+        LOG_WARNING("Cached program binary rejected, rebuilding from source");
+        if (program) clReleaseProgram(program);
+        return nullptr;
+    }
+    
+    // A binary still has to be built for the device; this is cheap compared to a compile
+    error = clBuildProgram(program, 1, &device, options.empty() ? NULL : options.c_str(), NULL, NULL);
+    if (error != CL_SUCCESS) {
+        LOG_WARNING("Cached program binary failed to build, rebuilding from source");
+        clReleaseProgram(program);
+        return nullptr;
+    }
     
     return program;
 }
 
+void OpenCLUtils::storeCachedProgram(cl_program program, const std::string& path) {
+    size_t binary_size = 0;
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &binary_size, NULL) != CL_SUCCESS ||
+        binary_size == 0) {
+        return;
+    }
+    std::vector<unsigned char> binary(binary_size);
+    unsigned char* binary_ptr = binary.data();
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char*), &binary_ptr, NULL) != CL_SUCCESS) {
+        return;
+    }
+    
+    // Failing to cache is not an error; the next start simply compiles again
+    mkdir(program_cache_directory.c_str(), 0755);
+    
+    // Write to a temporary name and rename so a crash never leaves a truncated binary behind
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_WARNING("Cannot write program cache: %s", temp_path.c_str());
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+        if (!file) {
+            std::remove(temp_path.c_str());
+            return;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+    }
+}
+
 std::string OpenCLUtils::readKernelSource(const std::string& filename) {
     std::ifstream file(filename);  // Fixed: should be 'ifstream' not 'iffile'
     if (!file.is_open()) {
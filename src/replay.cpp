@@ -0,0 +1,186 @@
+#include "replay.h"
+#include "motion_model.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <vector>
+
+namespace {
+
+// Frames of either a video file or a sorted image directory
+class FrameSource {
+public:
+    bool open(const std::string& path) {
+        struct stat info;
+        if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+            std::vector<std::string> files;
+            cv::glob(path + "/*", files, false);
+            for (size_t i = 0; i < files.size(); i++) {
+                std::string extension = files[i].substr(files[i].find_last_of('.') + 1);
+                std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+                if (extension == "jpg" || extension == "jpeg" || extension == "png" || extension == "bmp") {
+                    images.push_back(files[i]);
+                }
+            }
+            next_image = 0;
+            return !images.empty();
+        }
+        return capture.open(path);
+    }
+    
+    bool read(cv::Mat& frame) {
+        if (!images.empty() || !capture.isOpened()) {
+            if (next_image >= images.size()) {
+                return false;
+            }
+            frame = cv::imread(images[next_image++], cv::IMREAD_COLOR);
+            return !frame.empty();
+        }
+        return capture.read(frame) && !frame.empty();
+    }
+    
+    // Seconds between frames; image directories are taken to be 30 fps
+    double frameInterval() {
+        double fps = images.empty() && capture.isOpened() ? capture.get(cv::CAP_PROP_FPS) : 0.0;
+        return 1.0 / (fps > 0.0 ? fps : 30.0);
+    }
+    
+private:
+    cv::VideoCapture capture;
+    std::vector<std::string> images;
+    size_t next_image = 0;
+};
+
+bool readRoiFile(const std::string& path, cv::Rect& roi) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    std::getline(file, line);
+    return parseRoi(line, roi);
+}
+
+// Same threshold as the live loop for blending matches into the template
+const float kTemplateUpdateConfidence = 0.97f;
+
+double elapsedMs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+} // namespace
+
+bool parseRoi(const std::string& text, cv::Rect& roi) {
+    std::string values = text;
+    std::replace(values.begin(), values.end(), ',', ' ');
+    std::istringstream stream(values);
+    int x, y, width, height;
+    if (!(stream >> x >> y >> width >> height) || width <= 0 || height <= 0) {
+        return false;
+    }
+    roi = cv::Rect(x, y, width, height);
+    return true;
+}
+
+int runReplay(TrackerBackend& tracker, const ReplayOptions& options) {
+    FrameSource source;
+    if (!source.open(options.input)) {
+        std::cerr << "Cannot open replay input: " << options.input << std::endl;
+        return -1;
+    }
+    
+    cv::Rect roi = options.roi;
+    if (roi.empty()) {
+        std::string roi_file = options.roi_file.empty() ? options.input + ".roi" : options.roi_file;
+        if (!readRoiFile(roi_file, roi)) {
+            std::cerr << "No initial ROI: pass --roi=x,y,w,h or provide " << roi_file << std::endl;
+            return -1;
+        }
+    }
+    
+    std::string output_path = options.output.empty() ? options.input + ".track.csv" : options.output;
+    std::ofstream output(output_path);
+    if (!output.is_open()) {
+        std::cerr << "Cannot write replay output: " << output_path << std::endl;
+        return -1;
+    }
+    output << "frame,x,y,confidence,success,search_w,search_h,decode_ms,track_ms,total_ms\n";
+    
+    cv::Mat frame;
+    if (!source.read(frame)) {
+        std::cerr << "Replay input has no frames" << std::endl;
+        return -1;
+    }
+    if ((roi & cv::Rect(0, 0, frame.cols, frame.rows)) != roi) {
+        std::cerr << "Initial ROI lies outside the " << frame.cols << "x" << frame.rows << " frame" << std::endl;
+        return -1;
+    }
+    
+    tracker.setTemplate(frame(roi));
+    cv::Point track_point(roi.x + roi.width / 2, roi.y + roi.height / 2);
+    output << 0 << "," << track_point.x << "," << track_point.y << ",1,1,0,0,0,0,0\n";
+    
+    MotionModel motion;
+    motion.reset(track_point);
+    double frame_interval = source.frameInterval();
+    
+    int frames = 0;
+    int lost = 0;
+    double track_total_ms = 0.0;
+    std::chrono::steady_clock::time_point replay_start = std::chrono::steady_clock::now();
+    
+    for (int index = 1; ; index++) {
+        std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
+        if (!source.read(frame)) {
+            break;
+        }
+        std::chrono::steady_clock::time_point decoded = std::chrono::steady_clock::now();
+        
+        cv::Rect search_roi;
+        if (options.search_margin > 0) {
+            search_roi = cv::Rect(track_point.x - options.search_margin, track_point.y - options.search_margin,
+                                  options.search_margin * 2, options.search_margin * 2);
+            search_roi &= cv::Rect(0, 0, frame.cols, frame.rows);
+        } else {
+            motion.predict(frame_interval);
+            search_roi = motion.searchWindow(roi.size(), frame.size());
+        }
+        
+        cv::Point location;
+        float confidence = 0.0f;
+        bool success = false;
+        if (search_roi.width > roi.width && search_roi.height > roi.height) {
+            success = tracker.track(frame(search_roi), location, confidence);
+        }
+        if (success) {
+            track_point = location + search_roi.tl();
+            motion.correct(track_point, confidence);
+            if (options.template_rate > 0.0f && confidence > kTemplateUpdateConfidence) {
+                tracker.updateTemplate(options.template_rate);
+            }
+        } else {
+            lost++;
+        }
+        std::chrono::steady_clock::time_point tracked = std::chrono::steady_clock::now();
+        
+        double track_ms = elapsedMs(decoded, tracked);
+        track_total_ms += track_ms;
+        frames++;
+        output << index << "," << track_point.x << "," << track_point.y << "," << confidence << ","
+               << (success ? 1 : 0) << "," << search_roi.width << "," << search_roi.height << ","
+               << elapsedMs(frame_start, decoded) << "," << track_ms << ","
+               << elapsedMs(frame_start, tracked) << "\n";
+    }
+    
+    double replay_ms = elapsedMs(replay_start, std::chrono::steady_clock::now());
+    std::cout << "Replay: " << frames << " frames in " << replay_ms << " ms";
+    if (frames > 0) {
+        std::cout << " (" << 1000.0 * frames / replay_ms << " FPS overall, "
+                  << track_total_ms / frames << " ms mean track), " << lost << " lost";
+    }
+    std::cout << ", results in " << output_path << std::endl;
+    return 0;
+}
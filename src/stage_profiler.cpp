@@ -0,0 +1,143 @@
+#include "stage_profiler.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// Samples kept per stage; older ones are overwritten
+const size_t kProfileWindow = 512;
+
+float percentile(std::vector<float> values, double fraction) {
+    if (values.empty()) {
+        return 0.0f;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(fraction * (values.size() - 1) + 0.5);
+    return values[std::min(rank, values.size() - 1)];
+}
+
+} // namespace
+
+StageProfiler::StageProfiler() : enabled(false) {
+}
+
+StageProfiler::~StageProfiler() {
+    for (size_t i = 0; i < pending.size(); i++) {
+        clReleaseEvent(pending[i].event);
+    }
+}
+
+void StageProfiler::setEnabled(bool enable) {
+    enabled = enable;
+}
+
+bool StageProfiler::isEnabled() const {
+    return enabled;
+}
+
+cl_event* StageProfiler::newEvent(const char* stage) {
+    if (!enabled) {
+        return NULL;
+    }
+    PendingEvent entry;
+    entry.stage = stage;
+    entry.event = nullptr;
+    pending.push_back(entry);
+    return &pending.back().event;
+}
+
+void StageProfiler::collect() {
+    for (size_t i = 0; i < pending.size(); i++) {
+        cl_event event = pending[i].event;
+        if (event == nullptr) {
+            continue;
+        }
+        
+        cl_ulong queued = 0, submit = 0, start = 0, end = 0;
+        clWaitForEvents(1, &event);
+        cl_int error = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(cl_ulong), &queued, NULL);
+        if (error == CL_SUCCESS) {
+            error = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT, sizeof(cl_ulong), &submit, NULL);
+        }
+        if (error == CL_SUCCESS) {
+            error = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+        }
+        if (error == CL_SUCCESS) {
+            error = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+        }
+        
+        // Events from queues without profiling have no timestamps and are dropped
+        if (error == CL_SUCCESS) {
+            addSample(pending[i].stage, (end - start) * 1e-6f, (submit - queued) * 1e-6f, (start - submit) * 1e-6f);
+        }
+        clReleaseEvent(event);
+    }
+    pending.clear();
+}
+
+void StageProfiler::recordHost(const char* stage, double milliseconds) {
+    if (enabled) {
+        addSample(stage, static_cast<float>(milliseconds), -1.0f, -1.0f);
+    }
+}
+
+void StageProfiler::reset() {
+    collect();
+    stages.clear();
+}
+
+void StageProfiler::addSample(const std::string& stage, float execute_ms, float queue_ms, float launch_ms) {
+    std::map<std::string, StageSamples>::iterator it = stages.find(stage);
+    if (it == stages.end()) {
+        StageSamples empty;
+        empty.next = 0;
+        empty.count = 0;
+        it = stages.insert(std::make_pair(stage, empty)).first;
+    }
+    
+    StageSamples& samples = it->second;
+    if (samples.execute_ms.size() < kProfileWindow) {
+        samples.execute_ms.push_back(execute_ms);
+        samples.queue_ms.push_back(queue_ms);
+        samples.launch_ms.push_back(launch_ms);
+    } else {
+        samples.execute_ms[samples.next] = execute_ms;
+        samples.queue_ms[samples.next] = queue_ms;
+        samples.launch_ms[samples.next] = launch_ms;
+        samples.next = (samples.next + 1) % kProfileWindow;
+    }
+    samples.count++;
+}
+
+void StageProfiler::dump(std::ostream& out) const {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-22s %8s %9s %9s %9s %10s %10s",
+                  "stage", "count", "p50 ms", "p95 ms", "p99 ms", "queue p50", "launch p50");
+    out << line << "\n";
+    
+    for (std::map<std::string, StageSamples>::const_iterator it = stages.begin(); it != stages.end(); ++it) {
+        const StageSamples& samples = it->second;
+        
+        // Host samples carry no queue timestamps
+        std::vector<float> queue_delays, launch_delays;
+        for (size_t i = 0; i < samples.queue_ms.size(); i++) {
+            if (samples.queue_ms[i] >= 0.0f) {
+                queue_delays.push_back(samples.queue_ms[i]);
+                launch_delays.push_back(samples.launch_ms[i]);
+            }
+        }
+        
+        std::snprintf(line, sizeof(line), "%-22s %8llu %9.3f %9.3f %9.3f",
+                      it->first.c_str(), static_cast<unsigned long long>(samples.count),
+                      percentile(samples.execute_ms, 0.50), percentile(samples.execute_ms, 0.95),
+                      percentile(samples.execute_ms, 0.99));
+        out << line;
+        if (!queue_delays.empty()) {
+            std::snprintf(line, sizeof(line), " %10.3f %10.3f",
+                          percentile(queue_delays, 0.50), percentile(launch_delays, 0.50));
+            out << line;
+        }
+        out << "\n";
+    }
+    out.flush();
+}
@@ -0,0 +1,98 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdio>
+#include <pthread.h>
+
+ThreadPool::ThreadPool(int worker_count, const std::vector<int>& cores) :
+    stopping(false),
+    body(nullptr),
+    range_begin(0),
+    range_end(0),
+    chunk_size(0),
+    chunk_count(0),
+    next_chunk(0),
+    chunks_done(0)
+{
+    for (int i = 0; i < worker_count; i++) {
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+        
+        if (!cores.empty()) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(cores[i % cores.size()], &cpuset);
+            if (pthread_setaffinity_np(workers.back().native_handle(), sizeof(cpu_set_t), &cpuset) != 0) {
+                perror("Failed to set worker thread affinity");
+            }
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_cond.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+int ThreadPool::getThreadCount() const {
+    return static_cast<int>(workers.size()) + 1;
+}
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int, int)>& loop_body) {
+    int count = end - begin;
+    if (count <= 0) {
+        return;
+    }
+    if (workers.empty() || count == 1) {
+        loop_body(begin, end);
+        return;
+    }
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    int threads = getThreadCount();
+    body = &loop_body;
+    range_begin = begin;
+    range_end = end;
+    chunk_size = (count + threads - 1) / threads;
+    chunk_count = (count + chunk_size - 1) / chunk_size;
+    next_chunk = 0;
+    chunks_done = 0;
+    work_cond.notify_all();
+    
+    runChunks(lock);
+    done_cond.wait(lock, [this]() { return chunks_done == chunk_count; });
+    body = nullptr;
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work_cond.wait(lock, [this]() { return stopping || next_chunk < chunk_count; });
+        if (stopping) {
+            return;
+        }
+        runChunks(lock);
+    }
+}
+
+void ThreadPool::runChunks(std::unique_lock<std::mutex>& lock) {
+    // Chunks are claimed under the lock and run without it
+    while (next_chunk < chunk_count) {
+        int chunk = next_chunk++;
+        const std::function<void(int, int)>& loop_body = *body;
+        int chunk_begin = range_begin + chunk * chunk_size;
+        int chunk_end = std::min(range_end, chunk_begin + chunk_size);
+        
+        lock.unlock();
+        loop_body(chunk_begin, chunk_end);
+        lock.lock();
+        
+        if (++chunks_done == chunk_count) {
+            done_cond.notify_all();
+        }
+    }
+}
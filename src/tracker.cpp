@@ -1,9 +1,196 @@
 #include "tracker.h"
 #include "opencl_utils.h"
+#include "logger.h"
 #include <iostream>
 #include <random>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
 
-VisualTracker::VisualTracker() : template_initialized(false), template_buf(nullptr) {
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Largest template side kept at full resolution when the FFT path is available
+const int kMaxFftTemplateSize = 256;
+
+// Timed launches per path when calibrating the FFT switch, after one warm-up launch
+const int kFftCalibrationRuns = 3;
+
+int nextPowerOfTwo(int value) {
+    int result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Device buffer pool slots. Pyramid levels take consecutive slots from their base.
+enum BufferSlot {
+    kSlotTemplate,
+    kSlotTemplateZm,
+    kSlotTemplateSpectrum,
+    kSlotTemplateSpectrumScratch,
+    kSlotSearch,
+    kSlotCorrelation,
+    kSlotIntegralSum,
+    kSlotIntegralSqsum,
+    kSlotSpectrum,
+    kSlotSpectrumScratch,
+    kSlotWindowScores,
+    kSlotArgmaxPartialScores,
+    kSlotArgmaxPartialIndices,
+    kSlotArgmaxResult,
+    kSlotTopkScores,
+    kSlotTopkIndices,
+    kSlotTopkResult,
+    kSlotPyramidTemplate,
+    kSlotPyramidSearch = kSlotPyramidTemplate + 8,
+    kSlotPipelineSearch = kSlotPyramidSearch + 8,
+    kSlotPipelineResult = kSlotPipelineSearch + 4,
+    kSlotBatchTemplates = kSlotPipelineResult + 4,
+    kSlotBatchSearch,
+    kSlotBatchDescriptors,
+    kSlotBatchScores,
+    kSlotBatchResults,
+    kSlotTemplateAccumulator,
+    kSlotTemplateStats,
+    kSlotPyramidTemplateBytes,
+    kSlotBankTemplates = kSlotPyramidTemplateBytes + 2,
+    kSlotBankSearch,
+    kSlotBankDescriptors,
+    kSlotBankScores,
+    kSlotBankResults
+};
+
+// Ints per target descriptor, must match TARGET_DESC_STRIDE in the kernels
+const int kTargetDescriptorStride = 8;
+
+// Template sides that get kernels specialised at build time
+const int kSpecialisedTemplateSizes[] = {32, 48, 64, 80};
+
+bool isSpecialisedTemplateSize(int side) {
+    for (int size : kSpecialisedTemplateSizes) {
+        if (side == size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Buffer sets rotated by the asynchronous pipeline (upload, compute, readback)
+const int kPipelineDepth = 3;
+
+// Reasonable confidence threshold for NCC
+const float kConfidenceThreshold = 0.6f;
+
+// Results of jobs that were displaced before anyone waited for them
+const size_t kMaxCompletedResults = 16;
+
+// Pyramid levels are limited by the slots reserved for them
+const int kMaxPyramidLevels = 8;
+
+// Upper bounds for the argmax reduction: work-items per group and stage-1 groups
+const size_t kMaxArgmaxGroupSize = 256;
+const int kMaxArgmaxGroups = 64;
+
+// Most peaks getPeaks() reports, must match TOPK_MAX in the kernels
+const int kMaxTopK = 16;
+
+// Smallest template side worth matching at a coarse pyramid level
+const int kMinPyramidTemplateSize = 8;
+
+// Work-items of the single work-group that runs template_update
+const size_t kMaxTemplateUpdateGroupSize = 256;
+
+// Template bank variants smaller than this on either side are skipped
+const int kMinBankTemplateSize = 8;
+
+// Host counterpart of the downsample2x kernel, used for the template pyramid
+cv::Mat downsample2x(const cv::Mat& src) {
+    int channels = src.channels();
+    cv::Mat dst(src.rows / 2, src.cols / 2, src.type());
+    
+    for (int y = 0; y < dst.rows; y++) {
+        const uchar* top = src.ptr<uchar>(2 * y);
+        const uchar* bottom = src.ptr<uchar>(2 * y + 1);
+        uchar* out = dst.ptr<uchar>(y);
+        
+        for (int x = 0; x < dst.cols; x++) {
+            for (int ch = 0; ch < channels; ch++) {
+                int i = 2 * x * channels + ch;
+                int sum = top[i] + top[i + channels] + bottom[i] + bottom[i + channels];
+                out[x * channels + ch] = static_cast<uchar>((sum + 2) >> 2);
+            }
+        }
+    }
+    return dst;
+}
+
+}
+
+VisualTracker::VisualTracker() : 
+    context(nullptr),
+    device(nullptr),
+    queue(nullptr),
+    program(nullptr),
+    ncc_kernel(nullptr),
+    queue_profiling(false),
+    integral_rows_kernel(nullptr),
+    integral_cols_kernel(nullptr),
+    integral_ncc_kernel(nullptr),
+    ncc_method(NccMethod::Tiled),
+    tiled_ncc_kernel(nullptr),
+    local_mem_size(0),
+    fft_pack_bytes_kernel(nullptr),
+    fft_pack_floats_kernel(nullptr),
+    fft_radix2_kernel(nullptr),
+    fft_multiply_kernel(nullptr),
+    fft_normalize_kernel(nullptr),
+    fft_auto_switch(true),
+    template_spectrum_buf(nullptr),
+    downsample_kernel(nullptr),
+    window_search_kernel(nullptr),
+    pyramid_levels(1),
+    refine_radius(2),
+    argmax_partial_kernel(nullptr),
+    argmax_final_kernel(nullptr),
+    argmax_group_size(0),
+    topk_partial_kernel(nullptr),
+    topk_final_kernel(nullptr),
+    top_k(1),
+    peak_radius(0),
+    upload_queue(nullptr),
+    readback_queue(nullptr),
+    next_set(0),
+    next_ticket(1),
+    batched_ncc_kernel(nullptr),
+    batched_argmax_kernel(nullptr),
+    next_target_id(1),
+    targets_dirty(false),
+    active_variant(nullptr),
+    specialised_kernels(true),
+    color_mode(ColorMode::Bgr),
+    grayscale_ncc_kernel(nullptr),
+    template_buf(nullptr),
+    template_initialized(false),
+    template_zm_buf(nullptr),
+    template_norm(0.0f),
+    template_sum(0),
+    template_update_kernel(nullptr),
+    template_update_group_size(0),
+    last_search_buf(nullptr),
+    last_search_row_length(0),
+    last_match_valid(false),
+    template_accumulator_valid(false),
+    template_image_stale(false),
+    template_stats_event(nullptr)
+{
+    tile_local_size[0] = 8;
+    tile_local_size[1] = 8;
 }
 
 VisualTracker::~VisualTracker() {
@@ -13,17 +200,25 @@ VisualTracker::~VisualTracker() {
 bool VisualTracker::initialize() {
     try {
         context = OpenCLUtils::createContext();
-        queue = OpenCLUtils::createCommandQueue(context);
+        queue_profiling = profiler.isEnabled();
+        queue = OpenCLUtils::createCommandQueue(context, queue_profiling ? CL_QUEUE_PROFILING_ENABLE : 0);
+        clGetContextInfo(context, CL_CONTEXT_DEVICES, sizeof(cl_device_id), &device, NULL);
+        buffer_pool.setContext(context);
+        
+        // Separate queues let the upload, compute and readback of different frames overlap
+        upload_queue = OpenCLUtils::createCommandQueue(context);
+        readback_queue = OpenCLUtils::createCommandQueue(context);
+        clGetDeviceInfo(device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &local_mem_size, NULL);
         program = OpenCLUtils::createProgramFromFile(context, "tracker_kernels.cl");
         
         // Debug: Check available kernels
         size_t kernel_count;
         clGetProgramInfo(program, CL_PROGRAM_NUM_KERNELS, sizeof(size_t), &kernel_count, NULL);
-        std::cout << "Number of kernels in program: " << kernel_count << std::endl;
+        LOG_INFO("Number of kernels in program: %zu", kernel_count);
         
         char kernel_names[1024];
         clGetProgramInfo(program, CL_PROGRAM_KERNEL_NAMES, sizeof(kernel_names), kernel_names, NULL);
-        std::cout << "Available kernels: " << kernel_names << std::endl;
+        LOG_INFO("Available kernels: %s", kernel_names);
         
         // Try different kernel names
         const char* possible_kernel_names[] = {
@@ -43,7 +238,7 @@ bool VisualTracker::initialize() {
             kernel = clCreateKernel(program, possible_kernel_names[i], &error);
             if (error == CL_SUCCESS && kernel != NULL) {
                 used_kernel_name = possible_kernel_names[i];
-                std::cout << "Successfully created kernel: " << used_kernel_name << std::endl;
+                LOG_INFO("Successfully created kernel: %s", used_kernel_name);
                 break;
             }
         }
@@ -54,133 +249,1862 @@ bool VisualTracker::initialize() {
         
         ncc_kernel = kernel;
         
-        std::cout << "Simple NCC Tracker initialized successfully with kernel: " << used_kernel_name << std::endl;
+        // Integral-image NCC kernels; fall back to the direct kernel if missing
+        integral_rows_kernel = clCreateKernel(program, "integral_rows", &error);
+        if (error == CL_SUCCESS) {
+            integral_cols_kernel = clCreateKernel(program, "integral_cols", &error);
+        }
+        if (error == CL_SUCCESS) {
+            integral_ncc_kernel = clCreateKernel(program, "integral_ncc_tracker", &error);
+        }
+        if (error != CL_SUCCESS) {
+            LOG_WARNING("Integral NCC kernels not available, using direct NCC");
+            ncc_method = NccMethod::Direct;
+        } else {
+            tiled_ncc_kernel = clCreateKernel(program, "tiled_ncc_tracker", &error);
+            if (error != CL_SUCCESS || local_mem_size == 0) {
+                LOG_WARNING("Tiled NCC kernel not available, using integral NCC");
+                ncc_method = NccMethod::Integral;
+            }
+        }
+        
+        // Luma kernel for ColorMode::Gray; without it the generic kernels run with one channel
+        grayscale_ncc_kernel = clCreateKernel(program, "grayscale_ncc_tracker", &error);
+        if (error != CL_SUCCESS) {
+            grayscale_ncc_kernel = nullptr;
+        }
+        
+        // Frequency-domain kernels; without them only the spatial methods are used
+        const char* fft_kernel_names[] = {
+            "fft_pack_bytes", "fft_pack_floats", "fft_radix2", "fft_multiply_conj", "fft_ncc_normalize"
+        };
+        cl_kernel* fft_kernels[] = {
+            &fft_pack_bytes_kernel, &fft_pack_floats_kernel, &fft_radix2_kernel,
+            &fft_multiply_kernel, &fft_normalize_kernel
+        };
+        for (int i = 0; i < 5; i++) {
+            *fft_kernels[i] = clCreateKernel(program, fft_kernel_names[i], &error);
+            if (error != CL_SUCCESS) {
+                *fft_kernels[i] = nullptr;
+            }
+        }
+        if (!fftAvailable()) {
+            LOG_WARNING("FFT kernels not available, using spatial NCC only");
+        }
+        
+        // Pyramid kernels; without them the pyramid setting is ignored
+        downsample_kernel = clCreateKernel(program, "downsample2x", &error);
+        if (error != CL_SUCCESS) {
+            downsample_kernel = nullptr;
+        }
+        window_search_kernel = clCreateKernel(program, "ncc_window_search", &error);
+        if (error != CL_SUCCESS) {
+            window_search_kernel = nullptr;
+        }
+        
+        // Argmax reduction kernels; without them the map is scanned on the host
+        argmax_partial_kernel = clCreateKernel(program, "argmax_partial", &error);
+        if (error == CL_SUCCESS) {
+            argmax_final_kernel = clCreateKernel(program, "argmax_final", &error);
+        }
+        if (error == CL_SUCCESS) {
+            size_t partial_max = 0, final_max = 0;
+            clGetKernelWorkGroupInfo(argmax_partial_kernel, device, CL_KERNEL_WORK_GROUP_SIZE,
+                                     sizeof(size_t), &partial_max, NULL);
+            clGetKernelWorkGroupInfo(argmax_final_kernel, device, CL_KERNEL_WORK_GROUP_SIZE,
+                                     sizeof(size_t), &final_max, NULL);
+            size_t group_limit = std::min(kMaxArgmaxGroupSize, std::min(partial_max, final_max));
+            
+            // The tree reduction needs a power-of-two work-group
+            argmax_group_size = 1;
+            while (argmax_group_size * 2 <= group_limit) {
+                argmax_group_size *= 2;
+            }
+        } else {
+            LOG_WARNING("Argmax kernels not available, scanning correlation maps on the host");
+            LOG_WARNING("Asynchronous tracking will run synchronously");
+            if (argmax_partial_kernel) clReleaseKernel(argmax_partial_kernel);
+            argmax_partial_kernel = nullptr;
+            argmax_final_kernel = nullptr;
+        }
+        
+        // Batched multi-target kernels
+        batched_ncc_kernel = clCreateKernel(program, "batched_ncc_tracker", &error);
+        if (error == CL_SUCCESS) {
+            batched_argmax_kernel = clCreateKernel(program, "batched_argmax", &error);
+        }
+        if (error == CL_SUCCESS && argmax_group_size > 0) {
+            size_t batched_max = 0;
+            clGetKernelWorkGroupInfo(batched_argmax_kernel, device, CL_KERNEL_WORK_GROUP_SIZE,
+                                     sizeof(size_t), &batched_max, NULL);
+            while (argmax_group_size > batched_max && argmax_group_size > 1) {
+                argmax_group_size /= 2;
+            }
+        } else {
+            LOG_WARNING("Batched kernels not available, multi-target tracking disabled");
+            if (batched_ncc_kernel) clReleaseKernel(batched_ncc_kernel);
+            if (batched_argmax_kernel) clReleaseKernel(batched_argmax_kernel);
+            batched_ncc_kernel = nullptr;
+            batched_argmax_kernel = nullptr;
+        }
+        
+        // Top-K peak kernels share the argmax work-group size
+        topk_partial_kernel = clCreateKernel(program, "topk_partial", &error);
+        if (error == CL_SUCCESS) {
+            topk_final_kernel = clCreateKernel(program, "topk_final", &error);
+        }
+        if (error == CL_SUCCESS && argmax_group_size > 0) {
+            size_t partial_max = 0, final_max = 0;
+            clGetKernelWorkGroupInfo(topk_partial_kernel, device, CL_KERNEL_WORK_GROUP_SIZE,
+                                     sizeof(size_t), &partial_max, NULL);
+            clGetKernelWorkGroupInfo(topk_final_kernel, device, CL_KERNEL_WORK_GROUP_SIZE,
+                                     sizeof(size_t), &final_max, NULL);
+            while (argmax_group_size > std::min(partial_max, final_max) && argmax_group_size > 1) {
+                argmax_group_size /= 2;
+            }
+        } else {
+            LOG_WARNING("Top-K kernels not available, getPeaks() reports the best match only");
+            if (topk_partial_kernel) clReleaseKernel(topk_partial_kernel);
+            if (topk_final_kernel) clReleaseKernel(topk_final_kernel);
+            topk_partial_kernel = nullptr;
+            topk_final_kernel = nullptr;
+        }
+        
+        // Template adaptation; without it updateTemplate() reports that nothing was blended
+        template_update_kernel = clCreateKernel(program, "template_update", &error);
+        if (error == CL_SUCCESS) {
+            size_t update_max = 0;
+            clGetKernelWorkGroupInfo(template_update_kernel, device, CL_KERNEL_WORK_GROUP_SIZE,
+                                     sizeof(size_t), &update_max, NULL);
+            template_update_group_size = 1;
+            while (template_update_group_size * 2 <= std::min(update_max, kMaxTemplateUpdateGroupSize)) {
+                template_update_group_size *= 2;
+            }
+        } else {
+            LOG_WARNING("Template update kernel not available, templates will not adapt");
+            template_update_kernel = nullptr;
+        }
+        
+        PipelineSet empty_set;
+        empty_set.ticket = 0;
+        empty_set.search_buf = nullptr;
+        empty_set.result_buf = nullptr;
+        empty_set.upload_event = nullptr;
+        empty_set.compute_event = nullptr;
+        empty_set.readback_event = nullptr;
+        empty_set.corr_width = 0;
+        empty_set.search_row_length = 0;
+        pipeline_sets.assign(kPipelineDepth, empty_set);
+        
+        LOG_INFO("Simple NCC Tracker initialized successfully with kernel: %s", used_kernel_name);
         return true;
     } catch (const std::exception& e) {
-        std::cerr << "Initialization failed: " << e.what() << std::endl;
+        LOG_ERROR("Initialization failed: %s", e.what());
         return false;
     }
 }
 
 void VisualTracker::setTemplate(const cv::Mat& template_roi) {
+    // A pending statistics readback belongs to the previous template
+    syncTemplateStatistics();
+    
+    // Keep the original so a color mode change can re-apply it
+    template_source = template_roi.clone();
+    
     // Use original template size, but ensure it's not too large
-    cv::Mat processed = template_roi.clone();
+    cv::Mat processed;
+    convertForTracking(template_roi, processed);
     
-    // If template is too large, resize it
-    if (processed.cols > 100 || processed.rows > 100) {
+    // If template is too large, resize it. The FFT path scales with the search area
+    // rather than the template area, so it can afford much larger templates, but only
+    // when it is the selected method; the spatial kernels keep the small cap.
+    if (largeTemplatesAllowed()) {
+        int largest_side = std::max(processed.cols, processed.rows);
+        if (largest_side > kMaxFftTemplateSize) {
+            double scale = static_cast<double>(kMaxFftTemplateSize) / largest_side;
+            cv::resize(processed, processed, cv::Size(), scale, scale, cv::INTER_AREA);
+        }
+    } else if (processed.cols > 100 || processed.rows > 100) {
         cv::resize(processed, processed, cv::Size(80, 80));
     }
     
     template_size = processed.size();
     
-    // Clean up previous template
-    if (template_initialized) {
-        clReleaseMemObject(template_buf);
-    }
+    // Previous template buffers stay in the pool and are reused when large enough
+    template_spectrum_buf = nullptr;
+    spectrum_size = cv::Size();
+    fft_decisions.clear();
+    releaseTemplatePyramid();
     
-    // Create buffer for template
-    size_t template_size_bytes = template_size.width * template_size.height * 3 * sizeof(uchar);
-    template_buf = clCreateBuffer(context, CL_MEM_READ_ONLY, template_size_bytes, NULL, NULL);
+    // Get buffer for template
+    size_t template_size_bytes = template_size.width * template_size.height * channelCount() * sizeof(uchar);
+    template_buf = buffer_pool.acquire(kSlotTemplate, template_size_bytes);
     
     // Copy template to GPU
-    clEnqueueWriteBuffer(queue, template_buf, CL_TRUE, 0, template_size_bytes, processed.data, 0, NULL, NULL);
+    clEnqueueWriteBuffer(queue, template_buf, CL_TRUE, 0, template_size_bytes, processed.data,
+                         0, NULL, profiler.newEvent("template_upload"));
+    
+    // Template statistics only change through updateTemplate(), so compute them once here
+    std::vector<float> template_zm;
+    computeTemplateStatistics(processed, template_zm, template_norm, template_sum);
+    
+    size_t template_zm_bytes = template_zm.size() * sizeof(float);
+    template_zm_buf = buffer_pool.acquire(kSlotTemplateZm, template_zm_bytes);
+    clEnqueueWriteBuffer(queue, template_zm_buf, CL_TRUE, 0, template_zm_bytes, template_zm.data(),
+                         0, NULL, profiler.newEvent("template_stats_upload"));
+    
+    template_image = processed;
+    template_image_stale = false;
+    template_accumulator_valid = false;
+    last_match_valid = false;
+    buildTemplatePyramid();
+    buildTemplateBank();
+    selectKernelVariant();
     
     template_initialized = true;
-    std::cout << "Template set with size: " << template_size << std::endl;
+    profiler.collect();
+    LOG_INFO("Template set with size: %dx%d", template_size.width, template_size.height);
 }
 
 bool VisualTracker::track(const cv::Mat& search_region, cv::Point& location, float& confidence) {
     if (!template_initialized) {
-        std::cerr << "Template not initialized!" << std::endl;
+        LOG_EVERY_MS(LogLevel::Error, 1000, "Template not initialized!");
         return false;
     }
+    syncTemplateStatistics();
+    last_match_valid = false;
     
-    // Use search region as-is (no resizing)
-    cv::Mat processed_search = search_region.clone();
-    int search_width = processed_search.cols;
-    int search_height = processed_search.rows;
+    std::chrono::steady_clock::time_point track_start = std::chrono::steady_clock::now();
+    
+    // Use search region as-is (no resizing), converted to the tracking format
+    convertForTracking(search_region, search_staging);
+    profiler.recordHost("roi_convert", millisecondsSince(track_start));
+    int search_width = search_staging.cols;
+    int search_height = search_staging.rows;
+    int channels = channelCount();
     
     // Calculate correlation map size
     int corr_width = search_width - template_size.width;
     int corr_height = search_height - template_size.height;
     
-    std::cout << "Search: " << search_width << "x" << search_height 
-              << ", Template: " << template_size.width << "x" << template_size.height
-              << ", Corr map: " << corr_width << "x" << corr_height << std::endl;
+    LOG_EVERY_MS(LogLevel::Debug, 1000, "Search: %dx%d, Template: %dx%d, Corr map: %dx%d",
+                 search_width, search_height, template_size.width, template_size.height, corr_width, corr_height);
     
     if (corr_width <= 0 || corr_height <= 0) {
-        std::cerr << "Search region too small for template matching!" << std::endl;
+        LOG_EVERY_MS(LogLevel::Warning, 1000, "Search region too small for template matching!");
         // Fallback: return center of search region
         location = cv::Point(search_region.cols / 2, search_region.rows / 2);
         confidence = 0.0f;
         return false;
     }
     
-    // Create buffers
-    cl_mem search_buf = clCreateBuffer(context, CL_MEM_READ_ONLY, 
-                                      search_width * search_height * 3 * sizeof(uchar), NULL, NULL);
-    cl_mem correlation_buf = clCreateBuffer(context, CL_MEM_WRITE_ONLY, 
-                                          corr_width * corr_height * sizeof(float), NULL, NULL);
+    // Get buffers from the pool; they only grow when the search region does
+    size_t search_bytes = search_width * search_height * channels * sizeof(uchar);
+    cl_mem search_buf = buffer_pool.acquire(kSlotSearch, search_bytes, CL_MEM_READ_ONLY);
     
     // Copy search region to GPU
-    clEnqueueWriteBuffer(queue, search_buf, CL_TRUE, 0, 
-                        search_width * search_height * 3 * sizeof(uchar), processed_search.data, 0, NULL, NULL);
-    
-    // Create variables for literal values
-    int channels = 3; // RGB channels
-    
-    // Set kernel arguments
-    clSetKernelArg(ncc_kernel, 0, sizeof(cl_mem), &template_buf);
-    clSetKernelArg(ncc_kernel, 1, sizeof(cl_mem), &search_buf);
-    clSetKernelArg(ncc_kernel, 2, sizeof(cl_mem), &correlation_buf);
-    clSetKernelArg(ncc_kernel, 3, sizeof(int), &template_size.width);
-    clSetKernelArg(ncc_kernel, 4, sizeof(int), &template_size.height);
-    clSetKernelArg(ncc_kernel, 5, sizeof(int), &search_width);
-    clSetKernelArg(ncc_kernel, 6, sizeof(int), &search_height);
-    clSetKernelArg(ncc_kernel, 7, sizeof(int), &channels); // Use variable instead of &3
-    
-    // Execute kernel
-    size_t global_size[2] = {corr_width, corr_height};
-    clEnqueueNDRangeKernel(queue, ncc_kernel, 2, NULL, global_size, NULL, 0, NULL, NULL);
-    
-    // Read correlation map
-    std::vector<float> correlation_map(corr_width * corr_height);
-    clEnqueueReadBuffer(queue, correlation_buf, CL_TRUE, 0, 
-                       corr_width * corr_height * sizeof(float), correlation_map.data(), 0, NULL, NULL);
-    
-    // Find best match
+    clEnqueueWriteBuffer(queue, search_buf, CL_TRUE, 0, search_bytes, search_staging.data,
+                         0, NULL, profiler.newEvent("search_upload"));
+    
     float best_correlation = -1.0f;
     int best_x = 0, best_y = 0;
     
-    for (int y = 0; y < corr_height; y++) {
-        for (int x = 0; x < corr_width; x++) {
-            float corr = correlation_map[y * corr_width + x];
-            if (corr > best_correlation) {
-                best_correlation = corr;
-                best_x = x;
-                best_y = y;
-            }
+    peaks.clear();
+    
+    if (!template_pyramid.empty()) {
+        searchPyramid(search_buf, search_width, search_height, channels, best_x, best_y, best_correlation);
+    } else {
+        cl_mem correlation_buf = buffer_pool.acquire(kSlotCorrelation, corr_width * corr_height * sizeof(float));
+        
+        // Execute kernel
+        enqueueCorrelation(search_buf, correlation_buf, search_width, search_height, channels);
+        
+        // Reduce on the device and read back only the best match, or the peak list
+        // when more than one peak is requested; its first entry is the best match
+        int best_index = 0;
+        std::vector<std::pair<float, int> > top_candidates;
+        if (top_k > 1 && topk_partial_kernel &&
+            findPeaks(correlation_buf, corr_width, corr_height, top_candidates) > 0) {
+            best_correlation = top_candidates[0].first;
+            best_index = top_candidates[0].second;
+        } else {
+            best_correlation = findBestMatch(correlation_buf, corr_width * corr_height, best_index);
+        }
+        best_x = best_index % corr_width;
+        best_y = best_index / corr_width;
+        
+        for (size_t i = 0; i < top_candidates.size(); i++) {
+            CorrelationPeak peak;
+            peak.location = cv::Point(top_candidates[i].second % corr_width + template_size.width / 2,
+                                      top_candidates[i].second / corr_width + template_size.height / 2);
+            peak.score = top_candidates[i].first;
+            peaks.push_back(peak);
         }
     }
     
+    // Remembered for updateTemplate(), which reads the patch from the search buffer
+    last_search_buf = search_buf;
+    last_search_row_length = search_width * channels;
+    last_match = cv::Point(best_x, best_y);
+    last_match_valid = true;
+    
     // Convert to search region coordinates (center of template)
     location = cv::Point(best_x + template_size.width / 2, best_y + template_size.height / 2);
     confidence = best_correlation;
     
-    // Cleanup
-    clReleaseMemObject(search_buf);
-    clReleaseMemObject(correlation_buf);
+    if (peaks.empty()) {
+        CorrelationPeak peak;
+        peak.location = location;
+        peak.score = best_correlation;
+        peaks.push_back(peak);
+    }
+    
+    bool success = best_correlation > kConfidenceThreshold;
     
-    // Reasonable confidence threshold for NCC
-    bool success = best_correlation > 0.6f;
+    profiler.collect();
+    profiler.recordHost("track_total", millisecondsSince(track_start));
     
     if (!success) {
-        std::cout << "Low confidence match: " << best_correlation << std::endl;
+        LOG_EVERY_MS(LogLevel::Warning, 1000, "Low confidence match: %.3f", best_correlation);
     }
     
     return success;
 }
 
+bool VisualTracker::updateTemplate(float learning_rate) {
+    if (!template_initialized || !last_match_valid || template_update_kernel == nullptr) {
+        return false;
+    }
+    learning_rate = std::max(0.0f, std::min(learning_rate, 1.0f));
+    
+    int channels = channelCount();
+    int row_length = template_size.width * channels;
+    size_t template_count = static_cast<size_t>(row_length) * template_size.height;
+    cl_mem accumulator_buf = buffer_pool.acquire(kSlotTemplateAccumulator, template_count * sizeof(float));
+    cl_mem stats_buf = buffer_pool.acquire(kSlotTemplateStats, 2 * kMaxPyramidLevels * sizeof(cl_ulong));
+    
+    size_t local_size = template_update_group_size;
+    size_t local_bytes = local_size * sizeof(cl_ulong);
+    int patch_offset = last_match.y * last_search_row_length + last_match.x * channels;
+    int reset_accumulator = template_accumulator_valid ? 0 : 1;
+    int stats_index = 0;
+    
+    // Level 0: blend, round, re-centre and reduce in one launch
+    clSetKernelArg(template_update_kernel, 0, sizeof(cl_mem), &last_search_buf);
+    clSetKernelArg(template_update_kernel, 1, sizeof(int), &last_search_row_length);
+    clSetKernelArg(template_update_kernel, 2, sizeof(int), &patch_offset);
+    clSetKernelArg(template_update_kernel, 3, sizeof(cl_mem), &accumulator_buf);
+    clSetKernelArg(template_update_kernel, 4, sizeof(cl_mem), &template_buf);
+    clSetKernelArg(template_update_kernel, 5, sizeof(cl_mem), &template_zm_buf);
+    clSetKernelArg(template_update_kernel, 6, sizeof(cl_mem), &stats_buf);
+    clSetKernelArg(template_update_kernel, 7, local_bytes, NULL);
+    clSetKernelArg(template_update_kernel, 8, local_bytes, NULL);
+    clSetKernelArg(template_update_kernel, 9, sizeof(int), &row_length);
+    clSetKernelArg(template_update_kernel, 10, sizeof(int), &template_size.height);
+    clSetKernelArg(template_update_kernel, 11, sizeof(float), &learning_rate);
+    clSetKernelArg(template_update_kernel, 12, sizeof(int), &reset_accumulator);
+    clSetKernelArg(template_update_kernel, 13, sizeof(int), &stats_index);
+    clEnqueueNDRangeKernel(queue, template_update_kernel, 1, NULL, &local_size, &local_size,
+                           0, NULL, profiler.newEvent("template_update"));
+    
+    // Pyramid levels: downsample the new bytes level by level and re-centre each one
+    cl_mem level_source = template_buf;
+    cv::Size source_size = template_size;
+    int zero = 0;
+    float one = 1.0f;
+    for (size_t i = 0; i < template_pyramid.size(); i++) {
+        PyramidLevel& level = template_pyramid[i];
+        int level_index = static_cast<int>(i) + 1;
+        int level_row_length = level.template_size.width * channels;
+        cl_mem level_bytes = buffer_pool.acquire(kSlotPyramidTemplateBytes + static_cast<int>(i % 2),
+                                                 level.template_size.area() * channels * sizeof(uchar));
+        
+        clSetKernelArg(downsample_kernel, 0, sizeof(cl_mem), &level_source);
+        clSetKernelArg(downsample_kernel, 1, sizeof(cl_mem), &level_bytes);
+        clSetKernelArg(downsample_kernel, 2, sizeof(int), &source_size.width);
+        clSetKernelArg(downsample_kernel, 3, sizeof(int), &level.template_size.width);
+        clSetKernelArg(downsample_kernel, 4, sizeof(int), &level.template_size.height);
+        clSetKernelArg(downsample_kernel, 5, sizeof(int), &channels);
+        size_t level_global[2] = {
+            static_cast<size_t>(level.template_size.width),
+            static_cast<size_t>(level.template_size.height)
+        };
+        clEnqueueNDRangeKernel(queue, downsample_kernel, 2, NULL, level_global, NULL,
+                               0, NULL, profiler.newEvent("pyramid_template_downsample"));
+        
+        clSetKernelArg(template_update_kernel, 0, sizeof(cl_mem), &level_bytes);
+        clSetKernelArg(template_update_kernel, 1, sizeof(int), &level_row_length);
+        clSetKernelArg(template_update_kernel, 2, sizeof(int), &zero);
+        clSetKernelArg(template_update_kernel, 3, sizeof(cl_mem), NULL);
+        clSetKernelArg(template_update_kernel, 4, sizeof(cl_mem), NULL);
+        clSetKernelArg(template_update_kernel, 5, sizeof(cl_mem), &level.template_zm_buf);
+        clSetKernelArg(template_update_kernel, 9, sizeof(int), &level_row_length);
+        clSetKernelArg(template_update_kernel, 10, sizeof(int), &level.template_size.height);
+        clSetKernelArg(template_update_kernel, 11, sizeof(float), &one);
+        clSetKernelArg(template_update_kernel, 12, sizeof(int), &zero);
+        clSetKernelArg(template_update_kernel, 13, sizeof(int), &level_index);
+        clEnqueueNDRangeKernel(queue, template_update_kernel, 1, NULL, &local_size, &local_size,
+                               0, NULL, profiler.newEvent("pyramid_template_update"));
+        
+        level_source = level_bytes;
+        source_size = level.template_size;
+    }
+    
+    // The norms and the byte sum are kernel arguments, so the host needs them before the
+    // next track(); read them back without blocking and wait only when they are used
+    size_t stats_count = 2 * (template_pyramid.size() + 1);
+    template_stats.resize(stats_count);
+    clEnqueueReadBuffer(queue, stats_buf, CL_FALSE, 0, stats_count * sizeof(cl_ulong), template_stats.data(),
+                        0, NULL, &template_stats_event);
+    clFlush(queue);
+    
+    // The FFT spectrum is rebuilt on the device from template_zm_buf on its next use
+    spectrum_size = cv::Size();
+    template_accumulator_valid = true;
+    template_image_stale = true;
+    last_match_valid = false;
+    return true;
+}
+
+void VisualTracker::syncTemplateStatistics() {
+    if (template_stats_event == nullptr) {
+        return;
+    }
+    clWaitForEvents(1, &template_stats_event);
+    clReleaseEvent(template_stats_event);
+    template_stats_event = nullptr;
+    profiler.collect();
+    
+    int channels = channelCount();
+    for (size_t level = 0; level * 2 < template_stats.size(); level++) {
+        cv::Size size = level == 0 ? template_size : template_pyramid[level - 1].template_size;
+        double count = static_cast<double>(size.area()) * channels;
+        double sum = static_cast<double>(template_stats[2 * level]);
+        double sqsum = static_cast<double>(template_stats[2 * level + 1]);
+        float norm = static_cast<float>(std::sqrt(std::max(0.0, sqsum - sum * sum / count)));
+        if (level == 0) {
+            template_sum = static_cast<int>(template_stats[0]);
+            template_norm = norm;
+        } else {
+            template_pyramid[level - 1].template_norm = norm;
+        }
+    }
+}
+
+void VisualTracker::setSpecialisedKernels(bool enabled) {
+    specialised_kernels = enabled;
+    if (template_initialized) {
+        selectKernelVariant();
+    } else if (!enabled) {
+        active_variant = nullptr;
+    }
+}
+
+void VisualTracker::selectKernelVariant() {
+    active_variant = nullptr;
+    if (!specialised_kernels ||
+        !isSpecialisedTemplateSize(template_size.width) || !isSpecialisedTemplateSize(template_size.height)) {
+        return;
+    }
+    
+    std::string options = "-D TEMPLATE_W=" + std::to_string(template_size.width) +
+                          " -D TEMPLATE_H=" + std::to_string(template_size.height) +
+                          " -D CHANNELS=" + std::to_string(channelCount());
+    
+    std::map<std::string, KernelVariant>::const_iterator it = kernel_variants.find(options);
+    const KernelVariant* variant = it != kernel_variants.end() ? &it->second : buildKernelVariant(options);
+    if (variant->program) {
+        active_variant = variant;
+    }
+}
+
+const VisualTracker::KernelVariant* VisualTracker::buildKernelVariant(const std::string& options) {
+    KernelVariant variant;
+    variant.program = nullptr;
+    variant.direct = nullptr;
+    variant.integral = nullptr;
+    variant.tiled = nullptr;
+    variant.grayscale = nullptr;
+    
+    try {
+        variant.program = OpenCLUtils::createProgramFromFile(context, "tracker_kernels.cl", options);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Specialised kernel build failed (%s): %s", options.c_str(), e.what());
+    }
+    
+    if (variant.program) {
+        const char* names[] = {
+            "direct_ncc_tracker", "integral_ncc_tracker", "tiled_ncc_tracker", "grayscale_ncc_tracker"
+        };
+        cl_kernel* kernels[] = {&variant.direct, &variant.integral, &variant.tiled, &variant.grayscale};
+        bool complete = true;
+        for (int i = 0; i < 4; i++) {
+            cl_int error;
+            *kernels[i] = clCreateKernel(variant.program, names[i], &error);
+            if (error != CL_SUCCESS) {
+                *kernels[i] = nullptr;
+                complete = false;
+            }
+        }
+        
+        // Use a variant only as a whole so every method sees the same specialisation
+        if (!complete) {
+            LOG_WARNING("Specialised kernels incomplete (%s), using generic kernels", options.c_str());
+            for (int i = 0; i < 4; i++) {
+                if (*kernels[i]) clReleaseKernel(*kernels[i]);
+                *kernels[i] = nullptr;
+            }
+            clReleaseProgram(variant.program);
+            variant.program = nullptr;
+        } else {
+            LOG_INFO("Built specialised kernels: %s", options.c_str());
+        }
+    }
+    
+    // Failed builds are remembered too, so they are not retried on every template
+    return &(kernel_variants[options] = variant);
+}
+
+void VisualTracker::setColorMode(ColorMode mode) {
+    if (mode == color_mode) {
+        return;
+    }
+    color_mode = mode;
+    
+    if (template_initialized) {
+        cv::Mat source = template_source;
+        setTemplate(source);
+    }
+}
+
+ColorMode VisualTracker::getColorMode() const {
+    return color_mode;
+}
+
+const char* VisualTracker::getName() const {
+    return "OpenCL";
+}
+
+void VisualTracker::setProfiling(bool enabled) {
+    profiler.setEnabled(enabled);
+    
+    // Queue properties are fixed at creation, so an existing queue is replaced
+    if (enabled && queue && !queue_profiling) {
+        cl_int error;
+        clFinish(queue);
+        cl_command_queue profiling_queue = clCreateCommandQueue(context, device, CL_QUEUE_PROFILING_ENABLE, &error);
+        if (error != CL_SUCCESS) {
+            LOG_ERROR("Cannot create a profiling queue (error %d), profiling host stages only", error);
+            return;
+        }
+        clReleaseCommandQueue(queue);
+        queue = profiling_queue;
+        queue_profiling = true;
+    }
+}
+
+void VisualTracker::dumpProfile(std::ostream& out) {
+    profiler.collect();
+    profiler.dump(out);
+}
+
+int VisualTracker::channelCount() const {
+    return color_mode == ColorMode::Gray ? 1 : 3;
+}
+
+void VisualTracker::convertForTracking(const cv::Mat& image, cv::Mat& converted) const {
+    // Both paths write into `converted`, reusing its allocation when the size matches
+    if (color_mode == ColorMode::Gray) {
+        cv::cvtColor(image, converted, cv::COLOR_BGR2GRAY);
+    } else {
+        image.copyTo(converted);
+    }
+}
+
+void VisualTracker::setNccMethod(NccMethod method) {
+    if (method == NccMethod::Integral && integral_ncc_kernel == nullptr) {
+        LOG_WARNING("Integral NCC kernels not available, keeping current method");
+        return;
+    }
+    if (method == NccMethod::Fft && !fftAvailable()) {
+        LOG_WARNING("FFT kernels not available, keeping current method");
+        return;
+    }
+    if (method == NccMethod::Tiled && tiled_ncc_kernel == nullptr) {
+        LOG_WARNING("Tiled NCC kernel not available, keeping current method");
+        return;
+    }
+    bool large_templates = largeTemplatesAllowed();
+    ncc_method = method;
+    fft_decisions.clear();
+    
+    // Re-apply the template if the size cap changed with the method
+    if (template_initialized && largeTemplatesAllowed() != large_templates) {
+        cv::Mat source = template_source;
+        setTemplate(source);
+    }
+}
+
+NccMethod VisualTracker::getNccMethod() const {
+    return ncc_method;
+}
+
+void VisualTracker::setTileShape(int local_width, int local_height) {
+    if (local_width <= 0 || local_height <= 0) {
+        LOG_ERROR("Invalid tile shape: %dx%d", local_width, local_height);
+        return;
+    }
+    tile_local_size[0] = local_width;
+    tile_local_size[1] = local_height;
+    fft_decisions.clear();
+}
+
+void VisualTracker::setFftAutoSwitch(bool enabled) {
+    fft_auto_switch = enabled;
+    fft_decisions.clear();
+}
+
+bool VisualTracker::fftAvailable() const {
+    return fft_pack_bytes_kernel && fft_pack_floats_kernel && fft_radix2_kernel &&
+           fft_multiply_kernel && fft_normalize_kernel;
+}
+
+bool VisualTracker::largeTemplatesAllowed() const {
+    // The auto-switch may still pick a spatial kernel, so it keeps the spatial cap
+    return fftAvailable() && ncc_method == NccMethod::Fft;
+}
+
+bool VisualTracker::fftIsFaster(cl_mem search_buf, cl_mem correlation_buf,
+                                int search_width, int search_height, int channels) {
+    FftDecisionKey key(search_width, search_height, channels);
+    std::map<FftDecisionKey, bool>::const_iterator decision = fft_decisions.find(key);
+    if (decision != fft_decisions.end()) {
+        return decision->second;
+    }
+    
+    // Time both paths on this search size; the winner is cached until the template,
+    // method or tile shape changes. Calibration launches stay out of the stage profile.
+    bool profiling = profiler.isEnabled();
+    profiler.setEnabled(false);
+    
+    double best_ms[2] = { 0.0, 0.0 };
+    for (int use_fft = 0; use_fft < 2; use_fft++) {
+        for (int run = 0; run <= kFftCalibrationRuns; run++) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            if (use_fft) {
+                enqueueFftNcc(search_buf, correlation_buf, search_width, search_height, channels);
+            } else {
+                enqueueSpatialNcc(search_buf, correlation_buf, search_width, search_height, channels);
+            }
+            clFinish(queue);
+            double elapsed = millisecondsSince(start);
+            
+            // Run 0 warms up kernel caches and the template spectrum
+            if (run == 1 || (run > 1 && elapsed < best_ms[use_fft])) {
+                best_ms[use_fft] = elapsed;
+            }
+        }
+    }
+    
+    profiler.setEnabled(profiling);
+    
+    bool faster = best_ms[1] < best_ms[0];
+    LOG_INFO("FFT calibration for %dx%dx%d search: spatial %.3f ms, FFT %.3f ms, using %s",
+             search_width, search_height, channels, best_ms[0], best_ms[1], faster ? "FFT" : "spatial");
+    fft_decisions[key] = faster;
+    return faster;
+}
+
+void VisualTracker::setPyramid(int levels, int radius) {
+    if (levels > 1 && (downsample_kernel == nullptr || window_search_kernel == nullptr)) {
+        LOG_WARNING("Pyramid kernels not available, keeping single-level search");
+        return;
+    }
+    pyramid_levels = std::max(1, std::min(levels, kMaxPyramidLevels));
+    refine_radius = std::max(1, radius);
+    
+    if (template_initialized) {
+        // The pyramid is built from the host copy, which updateTemplate() leaves behind
+        syncTemplateStatistics();
+        if (template_image_stale) {
+            clEnqueueReadBuffer(queue, template_buf, CL_TRUE, 0, template_image.total() * template_image.elemSize(),
+                                template_image.data, 0, NULL, NULL);
+            template_image_stale = false;
+        }
+        releaseTemplatePyramid();
+        buildTemplatePyramid();
+    }
+}
+
+void VisualTracker::enqueueCorrelation(cl_mem search_buf, cl_mem correlation_buf,
+                                       int search_width, int search_height, int channels) {
+    bool use_fft = fftAvailable() &&
+        (ncc_method == NccMethod::Fft ||
+         (fft_auto_switch && fftIsFaster(search_buf, correlation_buf, search_width, search_height, channels)));
+    
+    if (use_fft) {
+        enqueueFftNcc(search_buf, correlation_buf, search_width, search_height, channels);
+    } else {
+        enqueueSpatialNcc(search_buf, correlation_buf, search_width, search_height, channels);
+    }
+}
+
+void VisualTracker::enqueueSpatialNcc(cl_mem search_buf, cl_mem correlation_buf,
+                                      int search_width, int search_height, int channels) {
+    if (channels == 1 && grayscale_ncc_kernel && ncc_method != NccMethod::Direct) {
+        enqueueGrayscaleNcc(search_buf, correlation_buf, search_width, search_height);
+    } else if (ncc_method == NccMethod::Tiled) {
+        enqueueTiledNcc(search_buf, correlation_buf, search_width, search_height, channels);
+    } else if (ncc_method == NccMethod::Integral) {
+        enqueueIntegralNcc(search_buf, correlation_buf, search_width, search_height, channels);
+    } else {
+        enqueueDirectNcc(search_buf, correlation_buf, search_width, search_height, channels);
+    }
+}
+
+uint64_t VisualTracker::submit(const cv::Mat& search_region) {
+    if (!template_initialized) {
+        LOG_EVERY_MS(LogLevel::Error, 1000, "Template not initialized!");
+        return 0;
+    }
+    syncTemplateStatistics();
+    last_match_valid = false;
+    
+    uint64_t ticket = next_ticket++;
+    
+    // The pipeline needs the on-device argmax and a single-pass search; otherwise
+    // keep the ROI and run track() when the result is collected, so updateTemplate()
+    // after wait() still sees the matching patch
+    if (argmax_partial_kernel == nullptr || !template_pyramid.empty() || pipeline_sets.empty()) {
+        if (deferred_regions.size() >= kMaxCompletedResults) {
+            deferred_regions.erase(deferred_regions.begin());
+        }
+        search_region.copyTo(deferred_regions[ticket]);
+        return ticket;
+    }
+    
+    int search_width = search_region.cols;
+    int search_height = search_region.rows;
+    int corr_width = search_width - template_size.width;
+    int corr_height = search_height - template_size.height;
+    int channels = channelCount();
+    
+    if (corr_width <= 0 || corr_height <= 0) {
+        TrackResult result;
+        result.location = cv::Point(search_width / 2, search_height / 2);
+        result.confidence = 0.0f;
+        result.success = false;
+        storeCompletedResult(ticket, result);
+        return ticket;
+    }
+    
+    // Take the next buffer set; if its previous job is still pending, finish it first
+    int set_index = next_set;
+    next_set = (next_set + 1) % static_cast<int>(pipeline_sets.size());
+    PipelineSet& set = pipeline_sets[set_index];
+    if (set.ticket != 0) {
+        uint64_t previous_ticket = set.ticket;
+        storeCompletedResult(previous_ticket, collectPipelineSet(set));
+    }
+    
+    // Stage the ROI in host memory owned by the set so the upload can run asynchronously
+    convertForTracking(search_region, set.staging);
+    size_t search_bytes = search_width * search_height * channels * sizeof(uchar);
+    set.search_buf = buffer_pool.acquire(kSlotPipelineSearch + set_index, search_bytes, CL_MEM_READ_ONLY);
+    set.result_buf = buffer_pool.acquire(kSlotPipelineResult + set_index, 2 * sizeof(int));
+    set.ticket = ticket;
+    set.corr_width = corr_width;
+    set.search_row_length = search_width * channels;
+    set.template_size = template_size;
+    
+    // Upload on its own queue
+    clEnqueueWriteBuffer(upload_queue, set.search_buf, CL_FALSE, 0, search_bytes, set.staging.data,
+                         0, NULL, &set.upload_event);
+    clFlush(upload_queue);
+    
+    // Compute on the main queue once the upload has landed
+    cl_mem correlation_buf = buffer_pool.acquire(kSlotCorrelation, corr_width * corr_height * sizeof(float));
+    clEnqueueBarrierWithWaitList(queue, 1, &set.upload_event, NULL);
+    enqueueCorrelation(set.search_buf, correlation_buf, search_width, search_height, channels);
+    enqueueArgmax(correlation_buf, corr_width * corr_height, set.result_buf);
+    clEnqueueMarkerWithWaitList(queue, 0, NULL, &set.compute_event);
+    clFlush(queue);
+    
+    // Read back the eight-byte result on the readback queue
+    clEnqueueReadBuffer(readback_queue, set.result_buf, CL_FALSE, 0, sizeof(set.result), set.result,
+                        1, &set.compute_event, &set.readback_event);
+    clFlush(readback_queue);
+    
+    return ticket;
+}
+
+bool VisualTracker::poll(uint64_t ticket) {
+    if (completed_results.count(ticket) || deferred_regions.count(ticket)) {
+        return true;
+    }
+    
+    for (size_t i = 0; i < pipeline_sets.size(); i++) {
+        if (pipeline_sets[i].ticket == ticket) {
+            cl_int status = CL_COMPLETE;
+            clGetEventInfo(pipeline_sets[i].readback_event, CL_EVENT_COMMAND_EXECUTION_STATUS,
+                           sizeof(cl_int), &status, NULL);
+            return status == CL_COMPLETE;
+        }
+    }
+    return false;
+}
+
+bool VisualTracker::wait(uint64_t ticket, cv::Point& location, float& confidence) {
+    std::map<uint64_t, cv::Mat>::iterator deferred = deferred_regions.find(ticket);
+    if (deferred != deferred_regions.end()) {
+        cv::Mat search_region = deferred->second;
+        deferred_regions.erase(deferred);
+        return track(search_region, location, confidence);
+    }
+    
+    TrackResult result;
+    std::map<uint64_t, TrackResult>::iterator completed = completed_results.find(ticket);
+    
+    if (completed != completed_results.end()) {
+        // Collected early to free its buffer set; the patch is gone
+        result = completed->second;
+        completed_results.erase(completed);
+        last_match_valid = false;
+    } else {
+        size_t i = 0;
+        while (i < pipeline_sets.size() && pipeline_sets[i].ticket != ticket) {
+            i++;
+        }
+        if (i == pipeline_sets.size()) {
+            LOG_EVERY_MS(LogLevel::Error, 1000, "Unknown or already collected tracking ticket: %llu",
+                         static_cast<unsigned long long>(ticket));
+            return false;
+        }
+        PipelineSet& set = pipeline_sets[i];
+        result = collectPipelineSet(set);
+        
+        // The ROI stays in the set's search buffer until the set comes round again,
+        // which waits for any template update reading it
+        last_match_valid = set.template_size == template_size;
+        last_search_buf = set.search_buf;
+        last_search_row_length = set.search_row_length;
+        last_match = result.location - cv::Point(set.template_size.width / 2, set.template_size.height / 2);
+    }
+    
+    location = result.location;
+    confidence = result.confidence;
+    return result.success;
+}
+
+TrackResult VisualTracker::collectPipelineSet(PipelineSet& set) {
+    clWaitForEvents(1, &set.readback_event);
+    
+    float best_score;
+    std::memcpy(&best_score, &set.result[0], sizeof(float));
+    int best_index = set.result[1];
+    
+    TrackResult result;
+    result.location = cv::Point(best_index % set.corr_width + set.template_size.width / 2,
+                                best_index / set.corr_width + set.template_size.height / 2);
+    result.confidence = best_score;
+    result.success = best_score > kConfidenceThreshold;
+    
+    clReleaseEvent(set.upload_event);
+    clReleaseEvent(set.compute_event);
+    clReleaseEvent(set.readback_event);
+    set.upload_event = nullptr;
+    set.compute_event = nullptr;
+    set.readback_event = nullptr;
+    set.ticket = 0;
+    profiler.collect();
+    
+    return result;
+}
+
+void VisualTracker::storeCompletedResult(uint64_t ticket, const TrackResult& result) {
+    // Tickets are increasing, so the smallest key is the oldest result
+    if (completed_results.size() >= kMaxCompletedResults) {
+        completed_results.erase(completed_results.begin());
+    }
+    completed_results[ticket] = result;
+}
+
+int VisualTracker::addTarget(const cv::Mat& template_roi, const cv::Point& position) {
+    // Same size policy as setTemplate without the FFT path
+    cv::Mat processed = template_roi.clone();
+    if (processed.cols > 100 || processed.rows > 100) {
+        cv::resize(processed, processed, cv::Size(80, 80));
+    }
+    
+    Target target;
+    target.id = next_target_id++;
+    target.template_size = processed.size();
+    int template_sum;
+    computeTemplateStatistics(processed, target.template_zm, target.template_norm, template_sum);
+    target.template_offset = 0;
+    target.position = position;
+    
+    targets.push_back(target);
+    targets_dirty = true;
+    return target.id;
+}
+
+bool VisualTracker::removeTarget(int id) {
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (targets[i].id == id) {
+            targets.erase(targets.begin() + i);
+            targets_dirty = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t VisualTracker::getTargetCount() const {
+    return targets.size();
+}
+
+void VisualTracker::uploadTargetTemplates() {
+    // Templates only change when targets are added or removed
+    std::vector<float> packed;
+    for (size_t i = 0; i < targets.size(); i++) {
+        targets[i].template_offset = static_cast<int>(packed.size());
+        packed.insert(packed.end(), targets[i].template_zm.begin(), targets[i].template_zm.end());
+    }
+    
+    cl_mem templates_buf = buffer_pool.acquire(kSlotBatchTemplates, packed.size() * sizeof(float), CL_MEM_READ_ONLY);
+    clEnqueueWriteBuffer(queue, templates_buf, CL_TRUE, 0, packed.size() * sizeof(float), packed.data(),
+                         0, NULL, NULL);
+    targets_dirty = false;
+}
+
+std::vector<TargetResult> VisualTracker::trackAll(const cv::Mat& frame, int search_margin) {
+    std::vector<TargetResult> results;
+    if (targets.empty()) {
+        return results;
+    }
+    if (batched_ncc_kernel == nullptr) {
+        LOG_EVERY_MS(LogLevel::Error, 1000, "Multi-target tracking is not available on this device");
+        return results;
+    }
+    if (frame.type() != CV_8UC3) {
+        LOG_EVERY_MS(LogLevel::Error, 1000, "trackAll expects a BGR frame");
+        return results;
+    }
+    
+    if (targets_dirty) {
+        uploadTargetTemplates();
+    }
+    
+    // Pack every target's search ROI and describe where its data lives
+    int channels = 3;
+    int target_count = static_cast<int>(targets.size());
+    cv::Rect frame_rect(0, 0, frame.cols, frame.rows);
+    std::vector<cv::Rect> search_rois(target_count);
+    
+    batch_search_staging.clear();
+    batch_descriptors.assign(target_count * kTargetDescriptorStride, 0);
+    int score_count = 0;
+    int max_corr_width = 0, max_corr_height = 0;
+    
+    for (int t = 0; t < target_count; t++) {
+        const Target& target = targets[t];
+        cv::Rect roi(target.position.x - search_margin, target.position.y - search_margin,
+                     search_margin * 2, search_margin * 2);
+        roi = roi & frame_rect;
+        search_rois[t] = roi;
+        
+        int search_offset = static_cast<int>(batch_search_staging.size());
+        for (int r = 0; r < roi.height; r++) {
+            const uchar* row = frame.ptr<uchar>(roi.y + r) + roi.x * channels;
+            batch_search_staging.insert(batch_search_staging.end(), row, row + roi.width * channels);
+        }
+        
+        int corr_width = std::max(0, roi.width - target.template_size.width);
+        int corr_height = std::max(0, roi.height - target.template_size.height);
+        max_corr_width = std::max(max_corr_width, corr_width);
+        max_corr_height = std::max(max_corr_height, corr_height);
+        
+        cl_int* desc = &batch_descriptors[t * kTargetDescriptorStride];
+        desc[0] = target.template_offset;
+        desc[1] = target.template_size.width;
+        desc[2] = target.template_size.height;
+        desc[3] = search_offset;
+        desc[4] = roi.width;
+        desc[5] = roi.height;
+        desc[6] = score_count;
+        std::memcpy(&desc[7], &target.template_norm, sizeof(float));
+        
+        score_count += corr_width * corr_height;
+    }
+    
+    cl_mem templates_buf = buffer_pool.acquire(kSlotBatchTemplates, 0, CL_MEM_READ_ONLY);
+    cl_mem search_buf = buffer_pool.acquire(kSlotBatchSearch, std::max<size_t>(1, batch_search_staging.size()),
+                                            CL_MEM_READ_ONLY);
+    cl_mem descriptors_buf = buffer_pool.acquire(kSlotBatchDescriptors, batch_descriptors.size() * sizeof(cl_int),
+                                                 CL_MEM_READ_ONLY);
+    cl_mem scores_buf = buffer_pool.acquire(kSlotBatchScores, std::max(1, score_count) * sizeof(float));
+    cl_mem results_buf = buffer_pool.acquire(kSlotBatchResults, target_count * 2 * sizeof(cl_int));
+    
+    if (!batch_search_staging.empty()) {
+        clEnqueueWriteBuffer(queue, search_buf, CL_FALSE, 0, batch_search_staging.size(),
+                             batch_search_staging.data(), 0, NULL, NULL);
+    }
+    clEnqueueWriteBuffer(queue, descriptors_buf, CL_FALSE, 0, batch_descriptors.size() * sizeof(cl_int),
+                         batch_descriptors.data(), 0, NULL, NULL);
+    
+    // One launch scores every target; the third dimension is the target index
+    if (max_corr_width > 0 && max_corr_height > 0) {
+        clSetKernelArg(batched_ncc_kernel, 0, sizeof(cl_mem), &templates_buf);
+        clSetKernelArg(batched_ncc_kernel, 1, sizeof(cl_mem), &search_buf);
+        clSetKernelArg(batched_ncc_kernel, 2, sizeof(cl_mem), &descriptors_buf);
+        clSetKernelArg(batched_ncc_kernel, 3, sizeof(cl_mem), &scores_buf);
+        clSetKernelArg(batched_ncc_kernel, 4, sizeof(int), &channels);
+        size_t global_size[3] = {
+            static_cast<size_t>(max_corr_width),
+            static_cast<size_t>(max_corr_height),
+            static_cast<size_t>(target_count)
+        };
+        clEnqueueNDRangeKernel(queue, batched_ncc_kernel, 3, NULL, global_size, NULL, 0, NULL, NULL);
+    }
+    
+    // One work-group per target finds its best match
+    clSetKernelArg(batched_argmax_kernel, 0, sizeof(cl_mem), &scores_buf);
+    clSetKernelArg(batched_argmax_kernel, 1, sizeof(cl_mem), &descriptors_buf);
+    clSetKernelArg(batched_argmax_kernel, 2, sizeof(cl_mem), &results_buf);
+    clSetKernelArg(batched_argmax_kernel, 3, argmax_group_size * sizeof(float), NULL);
+    clSetKernelArg(batched_argmax_kernel, 4, argmax_group_size * sizeof(int), NULL);
+    size_t argmax_global = target_count * argmax_group_size;
+    clEnqueueNDRangeKernel(queue, batched_argmax_kernel, 1, NULL, &argmax_global, &argmax_group_size,
+                           0, NULL, NULL);
+    
+    batch_results.resize(target_count * 2);
+    clEnqueueReadBuffer(queue, results_buf, CL_TRUE, 0, batch_results.size() * sizeof(cl_int),
+                        batch_results.data(), 0, NULL, NULL);
+    
+    for (int t = 0; t < target_count; t++) {
+        Target& target = targets[t];
+        TargetResult result;
+        result.id = target.id;
+        result.position = target.position;
+        result.confidence = 0.0f;
+        result.success = false;
+        
+        int best_index = batch_results[2 * t + 1];
+        if (best_index >= 0) {
+            std::memcpy(&result.confidence, &batch_results[2 * t], sizeof(float));
+            int corr_width = search_rois[t].width - target.template_size.width;
+            cv::Point location(best_index % corr_width + target.template_size.width / 2,
+                               best_index / corr_width + target.template_size.height / 2);
+            result.success = result.confidence > kConfidenceThreshold;
+            if (result.success) {
+                target.position = search_rois[t].tl() + location;
+                result.position = target.position;
+            }
+        }
+        results.push_back(result);
+    }
+    
+    return results;
+}
+
+void VisualTracker::setTemplateBank(const std::vector<float>& scales, const std::vector<float>& angles) {
+    if (batched_ncc_kernel == nullptr && !scales.empty() && !angles.empty()) {
+        LOG_WARNING("Batched kernels not available, template bank disabled");
+        return;
+    }
+    bank_scales.clear();
+    for (size_t i = 0; i < scales.size(); i++) {
+        if (scales[i] > 0.0f) {
+            bank_scales.push_back(scales[i]);
+        }
+    }
+    bank_angles = angles;
+    
+    if (template_initialized) {
+        buildTemplateBank();
+        profiler.collect();
+    }
+}
+
+size_t VisualTracker::getTemplateBankSize() const {
+    return template_bank.size();
+}
+
+void VisualTracker::buildTemplateBank() {
+    template_bank.clear();
+    if (bank_scales.empty() || bank_angles.empty()) {
+        return;
+    }
+    
+    double width = template_image.cols;
+    double height = template_image.rows;
+    std::vector<float> packed;
+    for (size_t s = 0; s < bank_scales.size(); s++) {
+        for (size_t a = 0; a < bank_angles.size(); a++) {
+            float scale = bank_scales[s];
+            float angle = bank_angles[a];
+            
+            // Largest rectangle of the template's aspect ratio that lies inside the
+            // rotated template, so no variant samples outside the original patch
+            double radians = angle * CV_PI / 180.0;
+            double c = std::fabs(std::cos(radians));
+            double sn = std::fabs(std::sin(radians));
+            double fit = std::min(width / (width * c + height * sn), height / (width * sn + height * c));
+            cv::Size size(cvFloor(width * scale * fit), cvFloor(height * scale * fit));
+            if (size.width < kMinBankTemplateSize || size.height < kMinBankTemplateSize) {
+                LOG_WARNING("Template bank variant %.2fx %.1f deg is too small, skipped", scale, angle);
+                continue;
+            }
+            
+            // Rotate and scale about the template centre, centred in the variant
+            cv::Mat transform = cv::getRotationMatrix2D(cv::Point2f(static_cast<float>((width - 1) * 0.5),
+                                                                    static_cast<float>((height - 1) * 0.5)),
+                                                        angle, scale);
+            transform.at<double>(0, 2) += (size.width - width) * 0.5;
+            transform.at<double>(1, 2) += (size.height - height) * 0.5;
+            cv::Mat variant_image;
+            cv::warpAffine(template_image, variant_image, transform, size, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+            
+            TemplateVariant variant;
+            variant.scale = scale;
+            variant.angle = angle;
+            variant.template_size = size;
+            variant.template_offset = static_cast<int>(packed.size());
+            std::vector<float> variant_zm;
+            int variant_sum;
+            computeTemplateStatistics(variant_image, variant_zm, variant.template_norm, variant_sum);
+            packed.insert(packed.end(), variant_zm.begin(), variant_zm.end());
+            template_bank.push_back(variant);
+        }
+    }
+    if (template_bank.empty()) {
+        return;
+    }
+    
+    // Uploaded once per template; tracking only uploads the search region
+    cl_mem bank_buf = buffer_pool.acquire(kSlotBankTemplates, packed.size() * sizeof(float), CL_MEM_READ_ONLY);
+    clEnqueueWriteBuffer(queue, bank_buf, CL_TRUE, 0, packed.size() * sizeof(float), packed.data(),
+                         0, NULL, profiler.newEvent("bank_template_upload"));
+    LOG_INFO("Template bank: %zu variants", template_bank.size());
+}
+
+VariantMatch VisualTracker::trackVariants(const cv::Mat& search_region) {
+    VariantMatch match;
+    match.location = cv::Point(search_region.cols / 2, search_region.rows / 2);
+    match.scale = 1.0f;
+    match.angle = 0.0f;
+    match.confidence = 0.0f;
+    match.success = false;
+    if (!template_initialized || template_bank.empty()) {
+        LOG_EVERY_MS(LogLevel::Error, 1000, "Template bank is empty, see setTemplateBank");
+        return match;
+    }
+    
+    // The patch read by updateTemplate() comes from track() only
+    last_match_valid = false;
+    
+    std::chrono::steady_clock::time_point track_start = std::chrono::steady_clock::now();
+    convertForTracking(search_region, search_staging);
+    profiler.recordHost("roi_convert", millisecondsSince(track_start));
+    int search_width = search_staging.cols;
+    int search_height = search_staging.rows;
+    int channels = channelCount();
+    
+    // Every variant reads the same search region at offset 0; maps are packed back to back
+    int variant_count = static_cast<int>(template_bank.size());
+    bank_descriptors.assign(variant_count * kTargetDescriptorStride, 0);
+    int score_count = 0;
+    int max_corr_width = 0, max_corr_height = 0;
+    for (int v = 0; v < variant_count; v++) {
+        const TemplateVariant& variant = template_bank[v];
+        int corr_width = std::max(0, search_width - variant.template_size.width);
+        int corr_height = std::max(0, search_height - variant.template_size.height);
+        max_corr_width = std::max(max_corr_width, corr_width);
+        max_corr_height = std::max(max_corr_height, corr_height);
+        
+        cl_int* desc = &bank_descriptors[v * kTargetDescriptorStride];
+        desc[0] = variant.template_offset;
+        desc[1] = variant.template_size.width;
+        desc[2] = variant.template_size.height;
+        desc[3] = 0;
+        desc[4] = search_width;
+        desc[5] = search_height;
+        desc[6] = score_count;
+        std::memcpy(&desc[7], &variant.template_norm, sizeof(float));
+        
+        score_count += corr_width * corr_height;
+    }
+    if (score_count == 0) {
+        LOG_EVERY_MS(LogLevel::Warning, 1000, "Search region too small for every template bank variant!");
+        return match;
+    }
+    
+    size_t search_bytes = static_cast<size_t>(search_width) * search_height * channels;
+    cl_mem bank_buf = buffer_pool.acquire(kSlotBankTemplates, 0, CL_MEM_READ_ONLY);
+    cl_mem search_buf = buffer_pool.acquire(kSlotBankSearch, search_bytes, CL_MEM_READ_ONLY);
+    cl_mem descriptors_buf = buffer_pool.acquire(kSlotBankDescriptors, bank_descriptors.size() * sizeof(cl_int),
+                                                 CL_MEM_READ_ONLY);
+    cl_mem scores_buf = buffer_pool.acquire(kSlotBankScores, score_count * sizeof(float));
+    cl_mem results_buf = buffer_pool.acquire(kSlotBankResults, variant_count * 2 * sizeof(cl_int));
+    
+    clEnqueueWriteBuffer(queue, search_buf, CL_FALSE, 0, search_bytes, search_staging.data,
+                         0, NULL, profiler.newEvent("search_upload"));
+    clEnqueueWriteBuffer(queue, descriptors_buf, CL_FALSE, 0, bank_descriptors.size() * sizeof(cl_int),
+                         bank_descriptors.data(), 0, NULL, NULL);
+    
+    // One launch scores every variant; the third dimension is the variant index
+    clSetKernelArg(batched_ncc_kernel, 0, sizeof(cl_mem), &bank_buf);
+    clSetKernelArg(batched_ncc_kernel, 1, sizeof(cl_mem), &search_buf);
+    clSetKernelArg(batched_ncc_kernel, 2, sizeof(cl_mem), &descriptors_buf);
+    clSetKernelArg(batched_ncc_kernel, 3, sizeof(cl_mem), &scores_buf);
+    clSetKernelArg(batched_ncc_kernel, 4, sizeof(int), &channels);
+    size_t global_size[3] = {
+        static_cast<size_t>(max_corr_width),
+        static_cast<size_t>(max_corr_height),
+        static_cast<size_t>(variant_count)
+    };
+    clEnqueueNDRangeKernel(queue, batched_ncc_kernel, 3, NULL, global_size, NULL,
+                           0, NULL, profiler.newEvent("bank_ncc"));
+    
+    // One work-group per variant finds its best match; only those pairs are read back
+    clSetKernelArg(batched_argmax_kernel, 0, sizeof(cl_mem), &scores_buf);
+    clSetKernelArg(batched_argmax_kernel, 1, sizeof(cl_mem), &descriptors_buf);
+    clSetKernelArg(batched_argmax_kernel, 2, sizeof(cl_mem), &results_buf);
+    clSetKernelArg(batched_argmax_kernel, 3, argmax_group_size * sizeof(float), NULL);
+    clSetKernelArg(batched_argmax_kernel, 4, argmax_group_size * sizeof(int), NULL);
+    size_t argmax_global = variant_count * argmax_group_size;
+    clEnqueueNDRangeKernel(queue, batched_argmax_kernel, 1, NULL, &argmax_global, &argmax_group_size,
+                           0, NULL, profiler.newEvent("bank_argmax"));
+    
+    bank_results.resize(variant_count * 2);
+    clEnqueueReadBuffer(queue, results_buf, CL_TRUE, 0, bank_results.size() * sizeof(cl_int),
+                        bank_results.data(), 0, NULL, profiler.newEvent("bank_readback"));
+    
+    // Highest score wins; ties go to the earlier variant
+    int best_variant = -1;
+    for (int v = 0; v < variant_count; v++) {
+        if (bank_results[2 * v + 1] < 0) {
+            continue;
+        }
+        float score;
+        std::memcpy(&score, &bank_results[2 * v], sizeof(float));
+        if (best_variant < 0 || score > match.confidence) {
+            best_variant = v;
+            match.confidence = score;
+        }
+    }
+    
+    if (best_variant >= 0) {
+        const TemplateVariant& variant = template_bank[best_variant];
+        int corr_width = search_width - variant.template_size.width;
+        int best_index = bank_results[2 * best_variant + 1];
+        match.location = cv::Point(best_index % corr_width + variant.template_size.width / 2,
+                                   best_index / corr_width + variant.template_size.height / 2);
+        match.scale = variant.scale;
+        match.angle = variant.angle;
+        match.success = match.confidence > kConfidenceThreshold;
+    }
+    
+    profiler.collect();
+    profiler.recordHost("bank_total", millisecondsSince(track_start));
+    if (!match.success) {
+        LOG_EVERY_MS(LogLevel::Warning, 1000, "Low confidence match: %.3f", match.confidence);
+    }
+    return match;
+}
+
+void VisualTracker::setTopK(int k, int suppression_radius) {
+    top_k = std::max(1, std::min(k, kMaxTopK));
+    peak_radius = std::max(0, suppression_radius);
+}
+
+const std::vector<CorrelationPeak>& VisualTracker::getPeaks() const {
+    return peaks;
+}
+
+size_t VisualTracker::getDeviceAllocationCount() const {
+    return buffer_pool.getAllocationCount();
+}
+
+float VisualTracker::findBestMatch(cl_mem scores_buf, int count, int& best_index) {
+    if (argmax_partial_kernel == nullptr) {
+        // Host fallback: read the whole map back and scan it
+        std::vector<float> scores(count);
+        clEnqueueReadBuffer(queue, scores_buf, CL_TRUE, 0, count * sizeof(float), scores.data(),
+                            0, NULL, profiler.newEvent("map_readback"));
+        
+        std::chrono::steady_clock::time_point scan_start = std::chrono::steady_clock::now();
+        float best_score = -1.0f;
+        best_index = 0;
+        for (int i = 0; i < count; i++) {
+            if (scores[i] > best_score) {
+                best_score = scores[i];
+                best_index = i;
+            }
+        }
+        profiler.recordHost("host_argmax", millisecondsSince(scan_start));
+        return best_score;
+    }
+    
+    cl_mem result_buf = buffer_pool.acquire(kSlotArgmaxResult, 2 * sizeof(int));
+    enqueueArgmax(scores_buf, count, result_buf);
+    
+    cl_int result[2];
+    clEnqueueReadBuffer(queue, result_buf, CL_TRUE, 0, sizeof(result), result,
+                        0, NULL, profiler.newEvent("result_readback"));
+    
+    float best_score;
+    std::memcpy(&best_score, &result[0], sizeof(float));
+    best_index = result[1];
+    return best_score;
+}
+
+int VisualTracker::findPeaks(cl_mem scores_buf, int map_width, int map_height,
+                             std::vector<std::pair<float, int> >& top_candidates) {
+    int count = map_width * map_height;
+    int radius = peak_radius > 0 ? peak_radius : std::min(template_size.width, template_size.height) / 2;
+    
+    // Stage 1: each work-group picks its own peaks from a contiguous chunk of the map
+    int group_count = static_cast<int>(std::min<size_t>(kMaxArgmaxGroups,
+                                                        (count + argmax_group_size - 1) / argmax_group_size));
+    int chunk_size = (count + group_count - 1) / group_count;
+    int candidate_count = group_count * kMaxTopK;
+    
+    cl_mem candidate_scores_buf = buffer_pool.acquire(kSlotTopkScores, kMaxArgmaxGroups * kMaxTopK * sizeof(float));
+    cl_mem candidate_indices_buf = buffer_pool.acquire(kSlotTopkIndices, kMaxArgmaxGroups * kMaxTopK * sizeof(int));
+    cl_mem result_buf = buffer_pool.acquire(kSlotTopkResult, 2 * kMaxTopK * sizeof(int));
+    
+    clSetKernelArg(topk_partial_kernel, 0, sizeof(cl_mem), &scores_buf);
+    clSetKernelArg(topk_partial_kernel, 1, sizeof(cl_mem), &candidate_scores_buf);
+    clSetKernelArg(topk_partial_kernel, 2, sizeof(cl_mem), &candidate_indices_buf);
+    clSetKernelArg(topk_partial_kernel, 3, argmax_group_size * sizeof(float), NULL);
+    clSetKernelArg(topk_partial_kernel, 4, argmax_group_size * sizeof(int), NULL);
+    clSetKernelArg(topk_partial_kernel, 5, sizeof(int), &map_width);
+    clSetKernelArg(topk_partial_kernel, 6, sizeof(int), &map_height);
+    clSetKernelArg(topk_partial_kernel, 7, sizeof(int), &chunk_size);
+    clSetKernelArg(topk_partial_kernel, 8, sizeof(int), &top_k);
+    clSetKernelArg(topk_partial_kernel, 9, sizeof(int), &radius);
+    size_t partial_global = group_count * argmax_group_size;
+    clEnqueueNDRangeKernel(queue, topk_partial_kernel, 1, NULL, &partial_global, &argmax_group_size,
+                           0, NULL, profiler.newEvent("topk_partial"));
+    
+    // Stage 2: a single work-group merges the lists with the same suppression
+    clSetKernelArg(topk_final_kernel, 0, sizeof(cl_mem), &candidate_scores_buf);
+    clSetKernelArg(topk_final_kernel, 1, sizeof(cl_mem), &candidate_indices_buf);
+    clSetKernelArg(topk_final_kernel, 2, sizeof(cl_mem), &result_buf);
+    clSetKernelArg(topk_final_kernel, 3, argmax_group_size * sizeof(float), NULL);
+    clSetKernelArg(topk_final_kernel, 4, argmax_group_size * sizeof(int), NULL);
+    clSetKernelArg(topk_final_kernel, 5, sizeof(int), &candidate_count);
+    clSetKernelArg(topk_final_kernel, 6, sizeof(int), &map_width);
+    clSetKernelArg(topk_final_kernel, 7, sizeof(int), &top_k);
+    clSetKernelArg(topk_final_kernel, 8, sizeof(int), &radius);
+    clEnqueueNDRangeKernel(queue, topk_final_kernel, 1, NULL, &argmax_group_size, &argmax_group_size,
+                           0, NULL, profiler.newEvent("topk_final"));
+    
+    // One readback of the (score bits, index) pairs, best first
+    std::vector<cl_int> result(2 * top_k);
+    clEnqueueReadBuffer(queue, result_buf, CL_TRUE, 0, result.size() * sizeof(cl_int), result.data(),
+                        0, NULL, profiler.newEvent("peaks_readback"));
+    
+    top_candidates.clear();
+    for (int i = 0; i < top_k && result[2 * i + 1] >= 0; i++) {
+        float score;
+        std::memcpy(&score, &result[2 * i], sizeof(float));
+        top_candidates.push_back(std::make_pair(score, result[2 * i + 1]));
+    }
+    return static_cast<int>(top_candidates.size());
+}
+
+int VisualTracker::enqueueArgmax(cl_mem scores_buf, int count, cl_mem result_buf) {
+    // Stage 1: one partial result per contiguous chunk of the map
+    int group_count = static_cast<int>(std::min<size_t>(kMaxArgmaxGroups,
+                                                        (count + argmax_group_size - 1) / argmax_group_size));
+    int chunk_size = (count + group_count - 1) / group_count;
+    
+    cl_mem partial_scores_buf = buffer_pool.acquire(kSlotArgmaxPartialScores, kMaxArgmaxGroups * sizeof(float));
+    cl_mem partial_indices_buf = buffer_pool.acquire(kSlotArgmaxPartialIndices, kMaxArgmaxGroups * sizeof(int));
+    
+    clSetKernelArg(argmax_partial_kernel, 0, sizeof(cl_mem), &scores_buf);
+    clSetKernelArg(argmax_partial_kernel, 1, sizeof(cl_mem), &partial_scores_buf);
+    clSetKernelArg(argmax_partial_kernel, 2, sizeof(cl_mem), &partial_indices_buf);
+    clSetKernelArg(argmax_partial_kernel, 3, argmax_group_size * sizeof(float), NULL);
+    clSetKernelArg(argmax_partial_kernel, 4, argmax_group_size * sizeof(int), NULL);
+    clSetKernelArg(argmax_partial_kernel, 5, sizeof(int), &count);
+    clSetKernelArg(argmax_partial_kernel, 6, sizeof(int), &chunk_size);
+    size_t partial_global = group_count * argmax_group_size;
+    clEnqueueNDRangeKernel(queue, argmax_partial_kernel, 1, NULL, &partial_global, &argmax_group_size,
+                           0, NULL, profiler.newEvent("argmax_partial"));
+    
+    // Stage 2: a single work-group combines the partial results
+    clSetKernelArg(argmax_final_kernel, 0, sizeof(cl_mem), &partial_scores_buf);
+    clSetKernelArg(argmax_final_kernel, 1, sizeof(cl_mem), &partial_indices_buf);
+    clSetKernelArg(argmax_final_kernel, 2, sizeof(cl_mem), &result_buf);
+    clSetKernelArg(argmax_final_kernel, 3, argmax_group_size * sizeof(float), NULL);
+    clSetKernelArg(argmax_final_kernel, 4, argmax_group_size * sizeof(int), NULL);
+    clSetKernelArg(argmax_final_kernel, 5, sizeof(int), &group_count);
+    clEnqueueNDRangeKernel(queue, argmax_final_kernel, 1, NULL, &argmax_group_size, &argmax_group_size,
+                           0, NULL, profiler.newEvent("argmax_final"));
+    
+    return group_count;
+}
+
+void VisualTracker::computeTemplateStatistics(const cv::Mat& processed, std::vector<float>& template_zm,
+                                              float& norm, int& sum) {
+    size_t total = processed.total() * processed.channels();
+    const uchar* data = processed.data;
+    
+    sum = 0;
+    for (size_t i = 0; i < total; i++) {
+        sum += data[i];
+    }
+    float mean = static_cast<float>(static_cast<double>(sum) / total);
+    
+    template_zm.resize(total);
+    double sqsum = 0.0;
+    for (size_t i = 0; i < total; i++) {
+        float value = data[i] - mean;
+        template_zm[i] = value;
+        sqsum += value * value;
+    }
+    norm = static_cast<float>(std::sqrt(sqsum));
+}
+
+void VisualTracker::enqueueDirectNcc(cl_mem search_buf, cl_mem correlation_buf,
+                                     int search_width, int search_height, int channels) {
+    cl_kernel kernel = active_variant ? active_variant->direct : ncc_kernel;
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &template_buf);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &search_buf);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &correlation_buf);
+    clSetKernelArg(kernel, 3, sizeof(int), &template_size.width);
+    clSetKernelArg(kernel, 4, sizeof(int), &template_size.height);
+    clSetKernelArg(kernel, 5, sizeof(int), &search_width);
+    clSetKernelArg(kernel, 6, sizeof(int), &search_height);
+    clSetKernelArg(kernel, 7, sizeof(int), &channels);
+    
+    size_t global_size[2] = {
+        static_cast<size_t>(search_width - template_size.width),
+        static_cast<size_t>(search_height - template_size.height)
+    };
+    clEnqueueNDRangeKernel(queue, kernel, 2, NULL, global_size, NULL,
+                           0, NULL, profiler.newEvent("ncc_direct"));
+}
+
+void VisualTracker::enqueueIntegralNcc(cl_mem search_buf, cl_mem correlation_buf,
+                                       int search_width, int search_height, int channels) {
+    cl_kernel kernel = active_variant ? active_variant->integral : integral_ncc_kernel;
+    size_t integral_count = (search_width + 1) * (search_height + 1);
+    cl_mem integral_sum_buf = buffer_pool.acquire(kSlotIntegralSum, integral_count * sizeof(cl_uint));
+    cl_mem integral_sqsum_buf = buffer_pool.acquire(kSlotIntegralSqsum, integral_count * sizeof(cl_ulong));
+    
+    enqueueIntegralImages(search_buf, integral_sum_buf, integral_sqsum_buf,
+                          search_width, search_height, channels);
+    
+    // One dot product per candidate against the zero-mean template
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &template_zm_buf);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &search_buf);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &integral_sum_buf);
+    clSetKernelArg(kernel, 3, sizeof(cl_mem), &integral_sqsum_buf);
+    clSetKernelArg(kernel, 4, sizeof(cl_mem), &correlation_buf);
+    clSetKernelArg(kernel, 5, sizeof(int), &template_size.width);
+    clSetKernelArg(kernel, 6, sizeof(int), &template_size.height);
+    clSetKernelArg(kernel, 7, sizeof(int), &search_width);
+    clSetKernelArg(kernel, 8, sizeof(int), &search_height);
+    clSetKernelArg(kernel, 9, sizeof(int), &channels);
+    clSetKernelArg(kernel, 10, sizeof(float), &template_norm);
+    
+    size_t global_size[2] = {
+        static_cast<size_t>(search_width - template_size.width),
+        static_cast<size_t>(search_height - template_size.height)
+    };
+    clEnqueueNDRangeKernel(queue, kernel, 2, NULL, global_size, NULL,
+                           0, NULL, profiler.newEvent("ncc_integral"));
+}
+
+void VisualTracker::enqueueGrayscaleNcc(cl_mem search_buf, cl_mem correlation_buf,
+                                        int search_width, int search_height) {
+    cl_kernel kernel = active_variant ? active_variant->grayscale : grayscale_ncc_kernel;
+    int channels = 1;
+    size_t integral_count = (search_width + 1) * (search_height + 1);
+    cl_mem integral_sum_buf = buffer_pool.acquire(kSlotIntegralSum, integral_count * sizeof(cl_uint));
+    cl_mem integral_sqsum_buf = buffer_pool.acquire(kSlotIntegralSqsum, integral_count * sizeof(cl_ulong));
+    enqueueIntegralImages(search_buf, integral_sum_buf, integral_sqsum_buf,
+                          search_width, search_height, channels);
+    
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &template_buf);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &search_buf);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &integral_sum_buf);
+    clSetKernelArg(kernel, 3, sizeof(cl_mem), &integral_sqsum_buf);
+    clSetKernelArg(kernel, 4, sizeof(cl_mem), &correlation_buf);
+    clSetKernelArg(kernel, 5, sizeof(int), &template_size.width);
+    clSetKernelArg(kernel, 6, sizeof(int), &template_size.height);
+    clSetKernelArg(kernel, 7, sizeof(int), &search_width);
+    clSetKernelArg(kernel, 8, sizeof(int), &search_height);
+    clSetKernelArg(kernel, 9, sizeof(int), &template_sum);
+    clSetKernelArg(kernel, 10, sizeof(float), &template_norm);
+    
+    size_t global_size[2] = {
+        static_cast<size_t>(search_width - template_size.width),
+        static_cast<size_t>(search_height - template_size.height)
+    };
+    clEnqueueNDRangeKernel(queue, kernel, 2, NULL, global_size, NULL,
+                           0, NULL, profiler.newEvent("ncc_grayscale"));
+}
+
+void VisualTracker::enqueueTiledNcc(cl_mem search_buf, cl_mem correlation_buf,
+                                    int search_width, int search_height, int channels) {
+    cl_kernel kernel = active_variant ? active_variant->tiled : tiled_ncc_kernel;
+    int corr_width = search_width - template_size.width;
+    int corr_height = search_height - template_size.height;
+    
+    // Shrink the requested work-group until the device accepts it
+    size_t local_size[2] = {tile_local_size[0], tile_local_size[1]};
+    size_t max_group_size = 0;
+    clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE,
+                             sizeof(size_t), &max_group_size, NULL);
+    while (max_group_size > 0 && local_size[0] * local_size[1] > max_group_size) {
+        if (local_size[1] > 1) {
+            local_size[1] /= 2;
+        } else {
+            local_size[0] /= 2;
+        }
+    }
+    
+    // Pick the number of template rows staged per pass from the local memory budget
+    int tile_width = local_size[0] * kTiledOutputs;
+    int tile_height = local_size[1];
+    int row_length = template_size.width * channels;
+    int tile_pitch = (((tile_width + template_size.width - 1) * channels) + 3) & ~3;
+    size_t local_budget = local_mem_size * 3 / 4;
+    
+    int block_rows = 0;
+    for (int rows = template_size.height; rows >= 1; rows--) {
+        size_t needed = rows * row_length + (tile_height + rows - 1) * tile_pitch;
+        if (needed <= local_budget) {
+            block_rows = rows;
+            break;
+        }
+    }
+    if (block_rows == 0) {
+        // Template rows are too wide to stage even one at a time
+        enqueueIntegralNcc(search_buf, correlation_buf, search_width, search_height, channels);
+        return;
+    }
+    
+    size_t integral_count = (search_width + 1) * (search_height + 1);
+    cl_mem integral_sum_buf = buffer_pool.acquire(kSlotIntegralSum, integral_count * sizeof(cl_uint));
+    cl_mem integral_sqsum_buf = buffer_pool.acquire(kSlotIntegralSqsum, integral_count * sizeof(cl_ulong));
+    enqueueIntegralImages(search_buf, integral_sum_buf, integral_sqsum_buf,
+                          search_width, search_height, channels);
+    
+    size_t template_tile_bytes = block_rows * row_length;
+    size_t search_tile_bytes = (tile_height + block_rows - 1) * tile_pitch;
+    
+    clSetKernelArg(kernel, 0, sizeof(cl_mem), &template_buf);
+    clSetKernelArg(kernel, 1, sizeof(cl_mem), &search_buf);
+    clSetKernelArg(kernel, 2, sizeof(cl_mem), &integral_sum_buf);
+    clSetKernelArg(kernel, 3, sizeof(cl_mem), &integral_sqsum_buf);
+    clSetKernelArg(kernel, 4, sizeof(cl_mem), &correlation_buf);
+    clSetKernelArg(kernel, 5, template_tile_bytes, NULL);
+    clSetKernelArg(kernel, 6, search_tile_bytes, NULL);
+    clSetKernelArg(kernel, 7, sizeof(int), &template_size.width);
+    clSetKernelArg(kernel, 8, sizeof(int), &template_size.height);
+    clSetKernelArg(kernel, 9, sizeof(int), &search_width);
+    clSetKernelArg(kernel, 10, sizeof(int), &search_height);
+    clSetKernelArg(kernel, 11, sizeof(int), &channels);
+    clSetKernelArg(kernel, 12, sizeof(int), &template_sum);
+    clSetKernelArg(kernel, 13, sizeof(float), &template_norm);
+    clSetKernelArg(kernel, 14, sizeof(int), &block_rows);
+    
+    // Round the grid up to whole tiles; work-items past the map edge only help loading
+    size_t groups_x = (corr_width + tile_width - 1) / tile_width;
+    size_t groups_y = (corr_height + tile_height - 1) / tile_height;
+    size_t global_size[2] = {groups_x * local_size[0], groups_y * local_size[1]};
+    clEnqueueNDRangeKernel(queue, kernel, 2, NULL, global_size, local_size,
+                           0, NULL, profiler.newEvent("ncc_tiled"));
+}
+
+void VisualTracker::enqueueFftNcc(cl_mem search_buf, cl_mem correlation_buf,
+                                  int search_width, int search_height, int channels) {
+    int row_length = search_width * channels;
+    cv::Size padded_size(nextPowerOfTwo(row_length), nextPowerOfTwo(search_height));
+    
+    // The template spectrum depends on the padded size, so it is rebuilt only when
+    // the search region changes size
+    if (padded_size != spectrum_size) {
+        updateTemplateSpectrum(padded_size, channels);
+    }
+    
+    size_t padded_count = static_cast<size_t>(padded_size.width) * padded_size.height;
+    cl_mem spectrum_buf = buffer_pool.acquire(kSlotSpectrum, padded_count * sizeof(cl_float2));
+    cl_mem scratch_buf = buffer_pool.acquire(kSlotSpectrumScratch, padded_count * sizeof(cl_float2));
+    
+    size_t integral_count = (search_width + 1) * (search_height + 1);
+    cl_mem integral_sum_buf = buffer_pool.acquire(kSlotIntegralSum, integral_count * sizeof(cl_uint));
+    cl_mem integral_sqsum_buf = buffer_pool.acquire(kSlotIntegralSqsum, integral_count * sizeof(cl_ulong));
+    enqueueIntegralImages(search_buf, integral_sum_buf, integral_sqsum_buf,
+                          search_width, search_height, channels);
+    
+    // Forward transform of the search region
+    float offset = 128.0f;
+    clSetKernelArg(fft_pack_bytes_kernel, 0, sizeof(cl_mem), &search_buf);
+    clSetKernelArg(fft_pack_bytes_kernel, 1, sizeof(cl_mem), &spectrum_buf);
+    clSetKernelArg(fft_pack_bytes_kernel, 2, sizeof(int), &row_length);
+    clSetKernelArg(fft_pack_bytes_kernel, 3, sizeof(int), &search_height);
+    clSetKernelArg(fft_pack_bytes_kernel, 4, sizeof(int), &padded_size.width);
+    clSetKernelArg(fft_pack_bytes_kernel, 5, sizeof(float), &offset);
+    size_t padded_global[2] = {
+        static_cast<size_t>(padded_size.width),
+        static_cast<size_t>(padded_size.height)
+    };
+    clEnqueueNDRangeKernel(queue, fft_pack_bytes_kernel, 2, NULL, padded_global, NULL,
+                           0, NULL, profiler.newEvent("fft_pack"));
+    enqueueFft2d(spectrum_buf, scratch_buf, padded_size.width, padded_size.height, -1.0f);
+    
+    // Pointwise multiply with the conjugate template spectrum, then back to space
+    clSetKernelArg(fft_multiply_kernel, 0, sizeof(cl_mem), &spectrum_buf);
+    clSetKernelArg(fft_multiply_kernel, 1, sizeof(cl_mem), &template_spectrum_buf);
+    clEnqueueNDRangeKernel(queue, fft_multiply_kernel, 1, NULL, &padded_count, NULL,
+                           0, NULL, profiler.newEvent("fft_multiply"));
+    enqueueFft2d(spectrum_buf, scratch_buf, padded_size.width, padded_size.height, 1.0f);
+    
+    // Windowed normalisation to the same score the spatial kernels produce
+    float inverse_scale = 1.0f / static_cast<float>(padded_count);
+    clSetKernelArg(fft_normalize_kernel, 0, sizeof(cl_mem), &spectrum_buf);
+    clSetKernelArg(fft_normalize_kernel, 1, sizeof(cl_mem), &integral_sum_buf);
+    clSetKernelArg(fft_normalize_kernel, 2, sizeof(cl_mem), &integral_sqsum_buf);
+    clSetKernelArg(fft_normalize_kernel, 3, sizeof(cl_mem), &correlation_buf);
+    clSetKernelArg(fft_normalize_kernel, 4, sizeof(int), &template_size.width);
+    clSetKernelArg(fft_normalize_kernel, 5, sizeof(int), &template_size.height);
+    clSetKernelArg(fft_normalize_kernel, 6, sizeof(int), &search_width);
+    clSetKernelArg(fft_normalize_kernel, 7, sizeof(int), &search_height);
+    clSetKernelArg(fft_normalize_kernel, 8, sizeof(int), &channels);
+    clSetKernelArg(fft_normalize_kernel, 9, sizeof(int), &padded_size.width);
+    clSetKernelArg(fft_normalize_kernel, 10, sizeof(float), &inverse_scale);
+    clSetKernelArg(fft_normalize_kernel, 11, sizeof(float), &template_norm);
+    size_t global_size[2] = {
+        static_cast<size_t>(search_width - template_size.width),
+        static_cast<size_t>(search_height - template_size.height)
+    };
+    clEnqueueNDRangeKernel(queue, fft_normalize_kernel, 2, NULL, global_size, NULL,
+                           0, NULL, profiler.newEvent("fft_normalize"));
+}
+
+void VisualTracker::enqueueFft2d(cl_mem& data, cl_mem& scratch, int width, int height, float direction) {
+    // Rows first (contiguous elements, one transform per row), then columns
+    struct Pass {
+        int n;
+        int batch;
+        int element_stride;
+        int batch_stride;
+    };
+    Pass passes[2] = {
+        {width, height, 1, width},
+        {height, width, width, 1}
+    };
+    
+    for (int dim = 0; dim < 2; dim++) {
+        const Pass& pass = passes[dim];
+        size_t global_size[2] = {
+            static_cast<size_t>(pass.n / 2),
+            static_cast<size_t>(pass.batch)
+        };
+        
+        for (int p = 1; p < pass.n; p <<= 1) {
+            clSetKernelArg(fft_radix2_kernel, 0, sizeof(cl_mem), &data);
+            clSetKernelArg(fft_radix2_kernel, 1, sizeof(cl_mem), &scratch);
+            clSetKernelArg(fft_radix2_kernel, 2, sizeof(int), &pass.n);
+            clSetKernelArg(fft_radix2_kernel, 3, sizeof(int), &p);
+            clSetKernelArg(fft_radix2_kernel, 4, sizeof(int), &pass.element_stride);
+            clSetKernelArg(fft_radix2_kernel, 5, sizeof(int), &pass.batch_stride);
+            clSetKernelArg(fft_radix2_kernel, 6, sizeof(float), &direction);
+            clEnqueueNDRangeKernel(queue, fft_radix2_kernel, 2, NULL, global_size, NULL,
+                                   0, NULL, profiler.newEvent("fft_radix2"));
+            
+            // Stockham passes are out of place: the output becomes the next input
+            std::swap(data, scratch);
+        }
+    }
+}
+
+void VisualTracker::updateTemplateSpectrum(cv::Size padded_size, int channels) {
+    // Both slots belong to the template spectrum: after an odd number of passes the
+    // result lives in the scratch slot's buffer, which must not be reused elsewhere
+    size_t padded_count = static_cast<size_t>(padded_size.width) * padded_size.height;
+    template_spectrum_buf = buffer_pool.acquire(kSlotTemplateSpectrum, padded_count * sizeof(cl_float2));
+    cl_mem scratch_buf = buffer_pool.acquire(kSlotTemplateSpectrumScratch, padded_count * sizeof(cl_float2));
+    
+    int row_length = template_size.width * channels;
+    clSetKernelArg(fft_pack_floats_kernel, 0, sizeof(cl_mem), &template_zm_buf);
+    clSetKernelArg(fft_pack_floats_kernel, 1, sizeof(cl_mem), &template_spectrum_buf);
+    clSetKernelArg(fft_pack_floats_kernel, 2, sizeof(int), &row_length);
+    clSetKernelArg(fft_pack_floats_kernel, 3, sizeof(int), &template_size.height);
+    clSetKernelArg(fft_pack_floats_kernel, 4, sizeof(int), &padded_size.width);
+    size_t padded_global[2] = {
+        static_cast<size_t>(padded_size.width),
+        static_cast<size_t>(padded_size.height)
+    };
+    clEnqueueNDRangeKernel(queue, fft_pack_floats_kernel, 2, NULL, padded_global, NULL,
+                           0, NULL, profiler.newEvent("fft_template_pack"));
+    enqueueFft2d(template_spectrum_buf, scratch_buf, padded_size.width, padded_size.height, -1.0f);
+    
+    spectrum_size = padded_size;
+}
+
+void VisualTracker::buildTemplatePyramid() {
+    cv::Mat level_image = template_image;
+    
+    for (int level = 1; level < pyramid_levels; level++) {
+        if (level_image.cols / 2 < kMinPyramidTemplateSize || level_image.rows / 2 < kMinPyramidTemplateSize) {
+            break;
+        }
+        level_image = downsample2x(level_image);
+        
+        PyramidLevel pyramid_level;
+        std::vector<float> level_zm;
+        int level_sum;
+        computeTemplateStatistics(level_image, level_zm, pyramid_level.template_norm, level_sum);
+        pyramid_level.template_size = level_image.size();
+        
+        size_t level_zm_bytes = level_zm.size() * sizeof(float);
+        pyramid_level.template_zm_buf = buffer_pool.acquire(kSlotPyramidTemplate + level, level_zm_bytes);
+        clEnqueueWriteBuffer(queue, pyramid_level.template_zm_buf, CL_TRUE, 0, level_zm_bytes,
+                             level_zm.data(), 0, NULL, profiler.newEvent("pyramid_template_upload"));
+        
+        template_pyramid.push_back(pyramid_level);
+    }
+}
+
+void VisualTracker::releaseTemplatePyramid() {
+    // Level buffers belong to the pool
+    template_pyramid.clear();
+}
+
+void VisualTracker::searchPyramid(cl_mem search_buf, int search_width, int search_height, int channels,
+                                  int& best_x, int& best_y, float& best_correlation) {
+    // Level 0 followed by the coarser levels, as far as the search region allows
+    std::vector<PyramidLevel> levels(1);
+    levels[0].template_zm_buf = template_zm_buf;
+    levels[0].template_size = template_size;
+    levels[0].template_norm = template_norm;
+    
+    for (size_t i = 0; i < template_pyramid.size(); i++) {
+        int level = static_cast<int>(i) + 1;
+        const cv::Size& level_template = template_pyramid[i].template_size;
+        if ((search_width >> level) <= level_template.width || (search_height >> level) <= level_template.height) {
+            break;
+        }
+        levels.push_back(template_pyramid[i]);
+    }
+    
+    // Downsample the search region on the device
+    std::vector<cl_mem> search_levels(levels.size());
+    std::vector<cv::Size> search_sizes(levels.size());
+    search_levels[0] = search_buf;
+    search_sizes[0] = cv::Size(search_width, search_height);
+    
+    for (size_t level = 1; level < levels.size(); level++) {
+        cv::Size src_size = search_sizes[level - 1];
+        cv::Size dst_size(src_size.width / 2, src_size.height / 2);
+        search_sizes[level] = dst_size;
+        search_levels[level] = buffer_pool.acquire(kSlotPyramidSearch + static_cast<int>(level),
+                                                   dst_size.area() * channels * sizeof(uchar));
+        
+        clSetKernelArg(downsample_kernel, 0, sizeof(cl_mem), &search_levels[level - 1]);
+        clSetKernelArg(downsample_kernel, 1, sizeof(cl_mem), &search_levels[level]);
+        clSetKernelArg(downsample_kernel, 2, sizeof(int), &src_size.width);
+        clSetKernelArg(downsample_kernel, 3, sizeof(int), &dst_size.width);
+        clSetKernelArg(downsample_kernel, 4, sizeof(int), &dst_size.height);
+        clSetKernelArg(downsample_kernel, 5, sizeof(int), &channels);
+        size_t global_size[2] = {
+            static_cast<size_t>(dst_size.width),
+            static_cast<size_t>(dst_size.height)
+        };
+        clEnqueueNDRangeKernel(queue, downsample_kernel, 2, NULL, global_size, NULL,
+                               0, NULL, profiler.newEvent("pyramid_downsample"));
+    }
+    
+    // Full search at the coarsest level, then refine around the upscaled best match
+    cv::Point best;
+    for (int level = static_cast<int>(levels.size()) - 1; level >= 0; level--) {
+        const PyramidLevel& template_level = levels[level];
+        int corr_width = search_sizes[level].width - template_level.template_size.width;
+        int corr_height = search_sizes[level].height - template_level.template_size.height;
+        
+        cv::Rect window(0, 0, corr_width, corr_height);
+        if (level < static_cast<int>(levels.size()) - 1) {
+            int center_x = std::min(best.x * 2, corr_width - 1);
+            int center_y = std::min(best.y * 2, corr_height - 1);
+            int x0 = std::max(0, center_x - refine_radius);
+            int y0 = std::max(0, center_y - refine_radius);
+            int x1 = std::min(corr_width - 1, center_x + refine_radius);
+            int y1 = std::min(corr_height - 1, center_y + refine_radius);
+            window = cv::Rect(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+        }
+        
+        best_correlation = searchWindow(template_level.template_zm_buf, template_level.template_size,
+                                        template_level.template_norm, search_levels[level],
+                                        search_sizes[level].width, channels, window, best);
+    }
+    
+    best_x = best.x;
+    best_y = best.y;
+}
+
+float VisualTracker::searchWindow(cl_mem level_template_zm, cv::Size level_template_size, float level_template_norm,
+                                  cl_mem level_search, int level_search_width, int channels,
+                                  const cv::Rect& window, cv::Point& best) {
+    cl_mem scores_buf = buffer_pool.acquire(kSlotWindowScores, window.area() * sizeof(float));
+    
+    clSetKernelArg(window_search_kernel, 0, sizeof(cl_mem), &level_template_zm);
+    clSetKernelArg(window_search_kernel, 1, sizeof(cl_mem), &level_search);
+    clSetKernelArg(window_search_kernel, 2, sizeof(cl_mem), &scores_buf);
+    clSetKernelArg(window_search_kernel, 3, sizeof(int), &level_template_size.width);
+    clSetKernelArg(window_search_kernel, 4, sizeof(int), &level_template_size.height);
+    clSetKernelArg(window_search_kernel, 5, sizeof(int), &level_search_width);
+    clSetKernelArg(window_search_kernel, 6, sizeof(int), &channels);
+    clSetKernelArg(window_search_kernel, 7, sizeof(int), &window.x);
+    clSetKernelArg(window_search_kernel, 8, sizeof(int), &window.y);
+    clSetKernelArg(window_search_kernel, 9, sizeof(int), &window.width);
+    clSetKernelArg(window_search_kernel, 10, sizeof(int), &window.height);
+    clSetKernelArg(window_search_kernel, 11, sizeof(float), &level_template_norm);
+    
+    size_t global_size[2] = {
+        static_cast<size_t>(window.width),
+        static_cast<size_t>(window.height)
+    };
+    clEnqueueNDRangeKernel(queue, window_search_kernel, 2, NULL, global_size, NULL,
+                           0, NULL, profiler.newEvent("pyramid_window_search"));
+    
+    int best_index = 0;
+    float best_score = findBestMatch(scores_buf, window.area(), best_index);
+    
+    best = cv::Point(window.x + best_index % window.width, window.y + best_index / window.width);
+    return best_score;
+}
+
+void VisualTracker::enqueueIntegralImages(cl_mem search_buf, cl_mem integral_sum_buf, cl_mem integral_sqsum_buf,
+                                          int search_width, int search_height, int channels) {
+    // Integral images of the search region: row prefix sums, then column prefix sums
+    clSetKernelArg(integral_rows_kernel, 0, sizeof(cl_mem), &search_buf);
+    clSetKernelArg(integral_rows_kernel, 1, sizeof(cl_mem), &integral_sum_buf);
+    clSetKernelArg(integral_rows_kernel, 2, sizeof(cl_mem), &integral_sqsum_buf);
+    clSetKernelArg(integral_rows_kernel, 3, sizeof(int), &search_width);
+    clSetKernelArg(integral_rows_kernel, 4, sizeof(int), &search_height);
+    clSetKernelArg(integral_rows_kernel, 5, sizeof(int), &channels);
+    size_t rows_size = search_height + 1;
+    clEnqueueNDRangeKernel(queue, integral_rows_kernel, 1, NULL, &rows_size, NULL,
+                           0, NULL, profiler.newEvent("integral_rows"));
+    
+    clSetKernelArg(integral_cols_kernel, 0, sizeof(cl_mem), &integral_sum_buf);
+    clSetKernelArg(integral_cols_kernel, 1, sizeof(cl_mem), &integral_sqsum_buf);
+    clSetKernelArg(integral_cols_kernel, 2, sizeof(int), &search_width);
+    clSetKernelArg(integral_cols_kernel, 3, sizeof(int), &search_height);
+    size_t cols_size = search_width + 1;
+    clEnqueueNDRangeKernel(queue, integral_cols_kernel, 1, NULL, &cols_size, NULL,
+                           0, NULL, profiler.newEvent("integral_cols"));
+}
+
 cv::Mat VisualTracker::preprocessImage(const cv::Mat& image) {
     cv::Mat resized;
     // Use larger size for template and keep search region even larger
@@ -195,11 +2119,66 @@ cv::Mat VisualTracker::preprocessImage(const cv::Mat& image) {
 }
 
 void VisualTracker::cleanup() {
-    if (template_initialized) {
-        clReleaseMemObject(template_buf);
+    // Finish in-flight pipeline jobs before their buffers go away
+    for (size_t i = 0; i < pipeline_sets.size(); i++) {
+        if (pipeline_sets[i].ticket != 0) {
+            collectPipelineSet(pipeline_sets[i]);
+        }
+    }
+    
+    if (profiler.isEnabled()) {
+        std::cout << "OpenCL stage profile:" << std::endl;
+        dumpProfile(std::cout);
+        profiler.setEnabled(false);
     }
+    pipeline_sets.clear();
+    completed_results.clear();
+    deferred_regions.clear();
+    
+    if (template_stats_event) {
+        clWaitForEvents(1, &template_stats_event);
+        clReleaseEvent(template_stats_event);
+        template_stats_event = nullptr;
+    }
+    last_search_buf = nullptr;
+    last_match_valid = false;
+    buffer_pool.releaseAll();
+    template_initialized = false;
     if (ncc_kernel) clReleaseKernel(ncc_kernel);
+    if (grayscale_ncc_kernel) clReleaseKernel(grayscale_ncc_kernel);
+    if (integral_rows_kernel) clReleaseKernel(integral_rows_kernel);
+    if (integral_cols_kernel) clReleaseKernel(integral_cols_kernel);
+    if (integral_ncc_kernel) clReleaseKernel(integral_ncc_kernel);
+    if (tiled_ncc_kernel) clReleaseKernel(tiled_ncc_kernel);
+    if (template_update_kernel) clReleaseKernel(template_update_kernel);
+    template_spectrum_buf = nullptr;
+    releaseTemplatePyramid();
+    if (downsample_kernel) clReleaseKernel(downsample_kernel);
+    if (window_search_kernel) clReleaseKernel(window_search_kernel);
+    if (argmax_partial_kernel) clReleaseKernel(argmax_partial_kernel);
+    if (argmax_final_kernel) clReleaseKernel(argmax_final_kernel);
+    if (topk_partial_kernel) clReleaseKernel(topk_partial_kernel);
+    if (topk_final_kernel) clReleaseKernel(topk_final_kernel);
+    if (batched_ncc_kernel) clReleaseKernel(batched_ncc_kernel);
+    if (batched_argmax_kernel) clReleaseKernel(batched_argmax_kernel);
+    if (fft_pack_bytes_kernel) clReleaseKernel(fft_pack_bytes_kernel);
+    if (fft_pack_floats_kernel) clReleaseKernel(fft_pack_floats_kernel);
+    if (fft_radix2_kernel) clReleaseKernel(fft_radix2_kernel);
+    if (fft_multiply_kernel) clReleaseKernel(fft_multiply_kernel);
+    if (fft_normalize_kernel) clReleaseKernel(fft_normalize_kernel);
+    for (std::map<std::string, KernelVariant>::iterator it = kernel_variants.begin(); it != kernel_variants.end(); ++it) {
+        KernelVariant& variant = it->second;
+        if (variant.direct) clReleaseKernel(variant.direct);
+        if (variant.integral) clReleaseKernel(variant.integral);
+        if (variant.tiled) clReleaseKernel(variant.tiled);
+        if (variant.grayscale) clReleaseKernel(variant.grayscale);
+        if (variant.program) clReleaseProgram(variant.program);
+    }
+    kernel_variants.clear();
+    active_variant = nullptr;
     if (program) clReleaseProgram(program);
+    if (upload_queue) clReleaseCommandQueue(upload_queue);
+    if (readback_queue) clReleaseCommandQueue(readback_queue);
     if (queue) clReleaseCommandQueue(queue);
     if (context) clReleaseContext(context);
 }
\ No newline at end of file
@@ -0,0 +1,23 @@
+#include "tracker_backend.h"
+#include "tracker.h"
+#include "native_tracker.h"
+#include "logger.h"
+
+std::unique_ptr<TrackerBackend> createTrackerBackend(BackendType type) {
+    if (type != BackendType::Native) {
+        std::unique_ptr<TrackerBackend> backend(new VisualTracker());
+        if (backend->initialize()) {
+            return backend;
+        }
+        if (type == BackendType::OpenCL) {
+            return nullptr;
+        }
+        LOG_WARNING("OpenCL backend unavailable, falling back to the native CPU backend");
+    }
+    
+    std::unique_ptr<TrackerBackend> backend(new NativeTracker());
+    if (!backend->initialize()) {
+        return nullptr;
+    }
+    return backend;
+}